@@ -0,0 +1,78 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+
+// Канал управления сервером: отправляет "set <параметр> <значение>" и печатает ответы сервера.
+// Команды берутся из аргументов (по тройке "set <параметр> <значение>") или, если их нет, построчно из stdin.
+
+int socket_fd;
+std::string recv_buffer;
+
+bool read_reply(std::string& line) {
+    char buffer[1024];
+    size_t pos;
+    while ((pos = recv_buffer.find('\n')) == std::string::npos) {
+        int n = recv(socket_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return false;
+        }
+        recv_buffer.append(buffer, n);
+    }
+    line = recv_buffer.substr(0, pos);
+    recv_buffer.erase(0, pos + 1);
+    return true;
+}
+
+// true, если сервер принял команду
+bool send_command(const std::string& command) {
+    std::string message = command + "\n";
+    send(socket_fd, message.c_str(), message.size(), 0);
+    std::string reply;
+    if (!read_reply(reply)) {
+        std::cerr << "Сервер закрыл соединение" << std::endl;
+        exit(1);
+    }
+    std::cout << reply << std::endl;
+    return lookup_command(message_word(reply, 0)) == Command::OK;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || (argc - 3) % 3 != 0) {
+        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт> [set <параметр> <значение> ...]\n"
+                  << "Параметры: write и review (uniform:a:b, exp:mean, lognormal:mu:sigma, const:x), accept (0..1)" << std::endl;
+        return 1;
+    }
+
+    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(atoi(argv[2]));
+    server_addr.sin_addr.s_addr = inet_addr(argv[1]);
+    if (connect(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Ошибка подключения к серверу" << std::endl;
+        return 1;
+    }
+    std::string hello = std::string(command_name(Command::ADMIN)) + "\n";
+    send(socket_fd, hello.c_str(), hello.size(), 0);
+
+    bool all_ok = true;
+    if (argc > 3) {
+        for (int i = 3; i < argc; i += 3) {
+            all_ok = send_command(std::string(argv[i]) + " " + argv[i + 1] + " " + argv[i + 2]) && all_ok;
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!message_word(line, 0).empty()) {
+                all_ok = send_command(line) && all_ok;
+            }
+        }
+    }
+    close(socket_fd);
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// Проверка, что маршрутизация сервера в установившемся режиме не выделяет память.
+// Программа подключает код server_10.cpp, подменяет operator new счетчиком и гоняет по кругу
+// разбор -> маршрутизацию -> отправку для трех клиентов на socketpair. После разогрева
+// (кольцевые буферы почтовых ящиков и буферы потоков выросли до рабочего размера)
+// счетчик выделений не должен меняться. Код возврата 0 - выделений не было.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long long> allocations(0);
+
+// Замены не встраиваются: иначе GCC видит free на указателе из operator new и предупреждает о несоответствии
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+#define main server_main
+#include "server_10.cpp"
+#undef main
+
+const int WARMUP_ROUNDS = 2000;
+const int MEASURED_ROUNDS = 20000;
+
+int peer_fds[3]; // концы socketpair на стороне клиентов
+
+// Ответы сервера вычитываются, чтобы буферы сокетов не переполнились
+void drain() {
+    char buffer[4096];
+    for (int fd : peer_fds) {
+        while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        }
+    }
+}
+
+void send_from(ClientRegistry& clients, TaskPool& tasks, int id, const LineBuffer& line) {
+    ClientRegistry::Guard guard(clients);
+    ParsedMessage parsed;
+    if (!parse_message(line.view(), parsed)) {
+        parsed.command = Command::UNKNOWN;
+    }
+    route_message(clients, tasks, id, clients.fd(id), line.view(), parsed);
+}
+
+// Один круг: каждый клиент отправляет программу следующему, тот берет ее из очереди,
+// выносит заключение, оба подтверждают почтовые ящики и присылают отчет stats
+void round(ClientRegistry& clients, TaskPool& tasks, int number) {
+    for (int author = 0; author < 3; author++) {
+        int reviewer = (author + 1) % 3;
+        LineBuffer check;
+        check << Command::CHECK << ' ' << reviewer << ' ' << author;
+        send_from(clients, tasks, author, check);
+
+        LineBuffer queue;
+        queue << Command::QUEUE << ' ' << reviewer;
+        send_from(clients, tasks, reviewer, queue);
+
+        LineBuffer reviewed;
+        reviewed << Command::REVIEWED << ' ' << author << ' ' << reviewer << ' ' << (number + author) % 2;
+        send_from(clients, tasks, reviewer, reviewed);
+
+        for (int id : {author, reviewer}) {
+            LineBuffer ack;
+            ack << Command::ACK << ' ' << id << ' ' << mailboxes[id].next_seq - 1;
+            send_from(clients, tasks, id, ack);
+        }
+
+        LineBuffer stats;
+        stats << Command::STATS << ' ' << author << ' ' << number * 10 << ' ' << number * 20 << ' ' << number * 5;
+        send_from(clients, tasks, author, stats);
+    }
+    LineBuffer unknown;
+    unknown << "hello " << number;
+    send_from(clients, tasks, number % 3, unknown);
+    drain();
+}
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    // Лог сервера не нужен, но путь Logger::log остается тем же
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+
+    TaskPool tasks(3);
+    ClientRegistry clients;
+    for (int id = 0; id < 3; id++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+            perror("socketpair");
+            return 2;
+        }
+        peer_fds[id] = pair[1];
+        clients.publish(id, pair[0]);
+        wait_graph.connection(id, true);
+    }
+
+    for (int i = 0; i < WARMUP_ROUNDS; i++) {
+        round(clients, tasks, i);
+    }
+    long long before = allocations.load();
+    for (int i = 0; i < MEASURED_ROUNDS; i++) {
+        round(clients, tasks, WARMUP_ROUNDS + i);
+    }
+    long long allocated = allocations.load() - before;
+
+    std::cout.flush();
+    dup2(saved_stdout, STDOUT_FILENO);
+    LineBuffer result;
+    result << "Кругов маршрутизации: " << MEASURED_ROUNDS << " (сообщений: " << MEASURED_ROUNDS * 19
+           << "), выделений памяти: " << allocated << '\n';
+    fwrite(result.data(), 1, result.size(), stdout);
+    if (allocated != 0) {
+        fputs("ОШИБКА: маршрутизация выделяет память в установившемся режиме\n", stdout);
+        return 1;
+    }
+    fputs("OK\n", stdout);
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include <queue>
+#include <deque>
+#include <algorithm>
 #include <iostream>
 #include <unistd.h>
 #include <signal.h>
@@ -8,17 +10,238 @@
 #include <arpa/inet.h>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <coroutine>
+#include <functional>
+#include <map>
+#include <memory>
+#include <poll.h>
+#include <fcntl.h>
+#include <set>
+#include <fstream>
+#include "protocol.h"
+#include "sim_random.h"
+#include "work_policy.h"
 
 
-std::queue<std::string> tasks;
+// Работа, которая ждет клиента локально
+struct LocalJob {
+    JobKind kind;
+    int peer_id;   // автор программы (для проверки) или проверяющий (для заключения)
+    int result;    // результат проверки для заключения
+    double duration; // ожидаемая длительность работы в секундах (проверка или написание/исправление)
+    unsigned long long order; // порядковый номер поступления
+    unsigned long long seq;   // номер сообщения в почтовом ящике на сервере (0 - без подтверждения)
+    std::chrono::steady_clock::time_point arrived;
+};
+
+// Статистика для сравнения политик: время цикла (от начала написания программы до ее принятия)
+// и задержка проверки (от получения чужой программы до отправки заключения)
+struct PolicyStats {
+    std::mutex mutex;
+    int cycles = 0;
+    double cycle_seconds_sum = 0;
+    int reviews = 0;
+    double review_latency_sum = 0;
+    double review_latency_max = 0;
+
+    void add_cycle(double seconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cycles++;
+        cycle_seconds_sum += seconds;
+    }
+
+    void add_review(double latency_seconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reviews++;
+        review_latency_sum += latency_seconds;
+        review_latency_max = std::max(review_latency_max, latency_seconds);
+    }
+
+    void print(WorkPolicy policy) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cout << std::fixed << std::setprecision(1)
+                  << "[Статистика] Политика: " << policy_names[policy]
+                  << ", принято программ: " << cycles
+                  << ", среднее время цикла: " << (cycles ? cycle_seconds_sum / cycles : 0) << " с"
+                  << ", проверок: " << reviews
+                  << ", средняя задержка проверки: " << (reviews ? review_latency_sum / reviews : 0) << " с"
+                  << ", максимальная: " << review_latency_max << " с" << std::endl;
+    }
+};
+
+// Учет времени программиста по состояниям из условия: пишет код (в том числе исправляет),
+// проверяет чужой код или спит (программа отправлена, проверять нечего).
+// Проверки в пуле идут параллельно основному потоку, поэтому состояние вычисляется по приоритету:
+// пока основной поток пишет - "пишет", иначе если идет хоть одна проверка - "проверяет", иначе "спит".
+enum ProgrammerState {
+    STATE_WRITING,
+    STATE_REVIEWING,
+    STATE_SLEEPING,
+};
+
+class StateClock {
+public:
+    void set_main(ProgrammerState state) {
+        std::lock_guard<std::mutex> lock(mutex);
+        account();
+        main_state = state;
+    }
+
+    void review_started() {
+        std::lock_guard<std::mutex> lock(mutex);
+        account();
+        active_reviews++;
+    }
+
+    void review_finished() {
+        std::lock_guard<std::mutex> lock(mutex);
+        account();
+        active_reviews--;
+    }
+
+    // Накопленное время в секундах: написание, проверка, сон
+    void totals(double result[3]) {
+        std::lock_guard<std::mutex> lock(mutex);
+        account();
+        for (int i = 0; i < 3; i++) {
+            result[i] = seconds[i];
+        }
+    }
+
+    void print() {
+        double t[3];
+        totals(t);
+        double total = t[0] + t[1] + t[2];
+        if (total <= 0) {
+            return;
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << "[Состояния] Пишет: " << t[0] << " с (" << 100 * t[0] / total << "%)"
+                  << ", проверяет: " << t[1] << " с (" << 100 * t[1] / total << "%)"
+                  << ", спит: " << t[2] << " с (" << 100 * t[2] / total << "%)"
+                  << ", загрузка: " << 100 * (t[0] + t[1]) / total << "%" << std::endl;
+    }
+
+private:
+    void account() {
+        auto now = std::chrono::steady_clock::now();
+        ProgrammerState state = main_state;
+        if (state != STATE_WRITING && active_reviews > 0) {
+            state = STATE_REVIEWING;
+        }
+        seconds[state] += std::chrono::duration<double>(now - since).count();
+        since = now;
+    }
+
+    std::mutex mutex;
+    ProgrammerState main_state = STATE_SLEEPING;
+    int active_reviews = 0;
+    double seconds[3] = {0, 0, 0};
+    std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+};
+
+ModelParams model;
+std::mutex model_mutex; // параметры меняет основной поток по команде администратора, а читают и потоки пула
+
+std::deque<LocalJob> jobs; // работы, полученные во время ожидания ответа от очереди
+unsigned long long next_job_order = 0;
+WorkPolicy work_policy = OLDEST_FIRST;
+PolicyStats policy_stats;
+StateClock state_clock;
 int socket_fd;
-int break_flag = 1;
+volatile sig_atomic_t break_flag = 1;
+volatile sig_atomic_t interrupted = 0;
+std::mutex send_mutex; // сообщения на сервер отправляют и основной поток, и потоки пула проверок
+const int STATE_REPORT_SECONDS = 5;
+const std::chrono::seconds BUSY_RETRY_DELAY(1); // пауза перед повтором сообщения, отклоненного сервером
+const std::chrono::seconds LOAD_TTL(10); // сведения о нагрузке старше этого считаются неизвестными
+const int MAX_DEFER_SECONDS = 10; // дольше этого новая программа не ждет разгрузки проверяющих
+double max_wait_seconds = 30; // порог ожидания проверки, выше которого проверяющий считается перегруженным (--max-wait)
+int department = -1; // номер отдела на сервере отделов (--department), -1 - строка department не отправляется
+
+struct ReviewerLoad {
+    int depth = 0;
+    long long wait_ms = 0;
+    std::chrono::steady_clock::time_point updated;
+    bool known = false;
 
+    bool overloaded() const {
+        return known && max_wait_seconds > 0 && wait_ms > max_wait_seconds * 1000
+            && std::chrono::steady_clock::now() - updated < LOAD_TTL;
+    }
+};
+
+// Обработчик только снимает флаг: статистику печатает main после выхода из цикла событий,
+// потому что печать берет мьютексы, которые в момент сигнала может держать прерванный поток
 void sigint_handler(int sig) {
     break_flag = 0;
-    std::cout << "SIGINT получен. Подготовка к завершению программы..." << std::endl;
-    close(socket_fd);
-    exit(0);
+    interrupted = 1;
+}
+
+std::chrono::steady_clock::duration seconds_to_duration(double seconds) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+int draw_verdict() {
+    double accept_probability;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        accept_probability = model.accept_probability;
+    }
+    return Distribution::bernoulli(accept_probability).sample(thread_rng()) != 0 ? 1 : 0;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void add_job(JobKind kind, int peer_id, int result, unsigned long long seq = 0) {
+    LocalJob job;
+    job.seq = seq;
+    job.kind = kind;
+    job.peer_id = peer_id;
+    job.result = result;
+    job.duration = (kind == REVIEW_JOB ? model.review_time : model.write_time).sample(thread_rng());
+    job.order = next_job_order++;
+    job.arrived = std::chrono::steady_clock::now();
+    jobs.push_back(job);
+}
+
+LocalJob take_job(size_t index) {
+    LocalJob job = jobs[index];
+    jobs.erase(jobs.begin() + index);
+    return job;
+}
+
+LocalJob take_next_job(WorkPolicy policy) {
+    size_t best = 0;
+    for (size_t i = 1; i < jobs.size(); i++) {
+        if (job_before(jobs[i], jobs[best], policy)) {
+            best = i;
+        }
+    }
+    return take_job(best);
+}
+
+// Пока программа не отправлена, берутся только чужие проверки: заключение по своей программе
+// остается в очереди и обрабатывается обычным путем после отправки
+bool take_next_review(WorkPolicy policy, LocalJob& job) {
+    size_t best = jobs.size();
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].kind == REVIEW_JOB && (best == jobs.size() || job_before(jobs[i], jobs[best], policy))) {
+            best = i;
+        }
+    }
+    if (best == jobs.size()) {
+        return false;
+    }
+    job = take_job(best);
+    return true;
 }
 
 enum MessageType {
@@ -27,225 +250,953 @@ enum MessageType {
     GET_QUEUE,
 };
 
+// Сокет неблокирующий, поэтому при заполненном буфере ждем возможности записи
+void send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, 0);
+        if (n > 0) {
+            data += n;
+            size -= n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            poll(&pfd, 1, 100);
+        } else {
+            return;
+        }
+    }
+}
+
 void send_message(int socket_fd, MessageType message_type, int id_to, int id_from, int result) {
-    std::string message_to_send = "";
+    LineBuffer message_to_send;
     if (message_type == REQUEST_CHECK) {
-        message_to_send = "check " + std::to_string(id_to) + " " + std::to_string(id_from);
+        message_to_send << Command::CHECK << ' ' << id_to << ' ' << id_from;
     } else if (message_type == REVIEW_RESULT) {
-        message_to_send = "reviewed " + std::to_string(id_to) + " " + std::to_string(id_from) + " " + std::to_string(result);
+        message_to_send << Command::REVIEWED << ' ' << id_to << ' ' << id_from << ' ' << result;
     } else if (message_type == GET_QUEUE) {
-        message_to_send = "queue " + std::to_string(id_to);
+        message_to_send << Command::QUEUE << ' ' << id_to;
     }
-    message_to_send += '\n';
+    message_to_send << '\n';
 
-    send(socket_fd, message_to_send.c_str(), message_to_send.size(), 0);
+    std::lock_guard<std::mutex> lock(send_mutex);
+    send_all(socket_fd, message_to_send.data(), message_to_send.size());
 }
 
+// Отчет о накопленном времени по состояниям: "stats <id> <пишет мс> <проверяет мс> <спит мс>".
+// Значения накопительные, поэтому потерянный или повторный отчет ничего не портит.
+void send_state_report(int socket_fd, int my_id) {
+    double t[3];
+    state_clock.totals(t);
+    LineBuffer message;
+    message << Command::STATS << ' ' << my_id;
+    for (double seconds : t) {
+        message << ' ' << static_cast<long long>(seconds * 1000);
+    }
+    message << '\n';
 
+    std::lock_guard<std::mutex> lock(send_mutex);
+    send_all(socket_fd, message.data(), message.size());
+}
 
-int main(int argc, char *argv[]) {
-    if (argc < 3 || argc > 4) {
-        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт сервера> [id]" << std::endl;
-        return 1;
+// Сессия на сервере: токен и номер, до которого все сообщения почтового ящика подтверждены.
+// Сообщение подтверждается, когда работа по нему выполнена (проверка отправлена или заключение
+// принято), поэтому после переподключения сервер повторит все незавершенные работы.
+// Состояние сохраняется в файл client_<id>.session (client_<отдел>_<id>.session с --department),
+// чтобы его мог продолжить новый процесс.
+class Session {
+public:
+    void start(int id, unsigned long long session_token) {
+        std::lock_guard<std::mutex> lock(mutex);
+        my_id = id;
+        token = session_token;
+        save();
     }
-    bool is_reconnect = false;
-    int passed_id = -1;
-    if (argc == 4) {
-        is_reconnect = true;
-        passed_id = atoi(argv[3]);
+
+    bool load(int id) {
+        std::ifstream file(file_name(id));
+        return static_cast<bool>(file >> token >> acked_seq);
     }
 
-    srand(time(NULL));
-    struct sigaction sa;
-    sa.sa_handler = &sigint_handler;
-    sa.sa_flags = 0;
-    sigaction(SIGINT, &sa, NULL);
-    signal(SIGPIPE, SIG_IGN);
+    unsigned long long get_token() const { return token; }
+    unsigned long long get_acked_seq() const { return acked_seq; }
+
+    // false, если сообщение с этим номером уже получено (повтор после переподключения)
+    bool accept(unsigned long long seq) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (seq <= acked_seq || outstanding.count(seq)) {
+            return false;
+        }
+        outstanding.insert(seq);
+        max_seen_seq = std::max(max_seen_seq, seq);
+        return true;
+    }
+
+    void complete(unsigned long long seq) {
+        if (seq == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        outstanding.erase(seq);
+        unsigned long long new_acked = outstanding.empty() ? max_seen_seq : *outstanding.begin() - 1;
+        if (new_acked <= acked_seq) {
+            return;
+        }
+        acked_seq = new_acked;
+        save();
+        LineBuffer message;
+        message << Command::ACK << ' ' << my_id << ' ' << acked_seq << '\n';
+        std::lock_guard<std::mutex> send_lock(send_mutex);
+        send_all(socket_fd, message.data(), message.size());
+    }
 
-    std::string host_address = argv[1];
-    int port = atoi(argv[2]);
+private:
+    static std::string file_name(int id) {
+        if (department >= 0) {
+            return "client_" + std::to_string(department) + "_" + std::to_string(id) + ".session";
+        }
+        return "client_" + std::to_string(id) + ".session";
+    }
 
-    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd < 0) {
-        std::cerr << "Ошибка создания сокета" << std::endl;
-        return 1;
+    void save() {
+        std::ofstream file(file_name(my_id), std::ios::trunc);
+        file << token << " " << acked_seq << std::endl;
+    }
+
+    int my_id = -1;
+    unsigned long long token = 0;
+    unsigned long long acked_seq = 0;
+    unsigned long long max_seen_seq = 0;
+    std::set<unsigned long long> outstanding;
+    std::mutex mutex;
+};
+
+Session session;
+
+// Корутина, которую можно запускать сверху (start) или ждать из другой корутины (co_await).
+// Стартует лениво, по завершении передает управление тому, кто ее ждал.
+class Task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                auto continuation = h.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    void start() { handle.resume(); }
+    bool done() const { return handle.done(); }
+
+    bool await_ready() { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    void await_resume() {}
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Цикл событий над неблокирующим сокетом: читает строки от сервера, отдает их обработчику
+// и будит корутины, чьи таймеры истекли или чьи события произошли.
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    EventLoop(int fd, std::function<void(std::string_view)> on_line) : fd(fd), on_line(std::move(on_line)) {}
+
+    void schedule(std::coroutine_handle<> h) {
+        ready.push_back(h);
+    }
+
+    void add_timer(Clock::time_point deadline, std::function<void()> callback) {
+        timers.emplace(deadline, std::move(callback));
+    }
+
+    struct SleepAwaiter {
+        EventLoop& loop;
+        Clock::duration duration;
+        bool await_ready() { return duration <= Clock::duration::zero(); }
+        void await_suspend(std::coroutine_handle<> h) {
+            loop.add_timer(Clock::now() + duration, [this, h]() { loop.schedule(h); });
+        }
+        void await_resume() {}
+    };
+
+    SleepAwaiter sleep(Clock::duration duration) {
+        return SleepAwaiter{*this, duration};
+    }
+
+    // Выполняет одну итерацию: ожидание сокета/таймера, чтение, запуск готовых корутин.
+    // Возвращает false, если сервер закрыл соединение.
+    bool run_once() {
+        int timeout_ms = -1;
+        if (!ready.empty()) {
+            timeout_ms = 0;
+        } else if (!timers.empty()) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(timers.begin()->first - Clock::now()).count();
+            timeout_ms = wait < 0 ? 0 : static_cast<int>(wait) + 1;
+        }
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ret = poll(&pfd, 1, timeout_ms);
+        if (ret > 0 && !read_socket()) {
+            return false;
+        }
+
+        auto now = Clock::now();
+        while (!timers.empty() && timers.begin()->first <= now) {
+            auto callback = std::move(timers.begin()->second);
+            timers.erase(timers.begin());
+            callback();
+        }
+
+        while (!ready.empty()) {
+            auto h = ready.front();
+            ready.pop_front();
+            h.resume();
+        }
+        return true;
     }
 
+    // Переход на новое соединение (переключение на резервный сервер). Недочитанная строка
+    // старого соединения отбрасывается: сервер повторит неподтвержденные сообщения целиком.
+    void set_fd(int new_fd) {
+        fd = new_fd;
+        recv_buffer.clear();
+    }
+
+    // Разбор уже прочитанных байтов (например, пришедших вместе с ответом start)
+    void feed(const char* data, size_t size) {
+        recv_buffer.append(data, size);
+        size_t consumed = 0;
+        size_t pos;
+        while ((pos = recv_buffer.find('\n', consumed)) != std::string::npos) {
+            std::string_view message(recv_buffer.data() + consumed, pos - consumed);
+            consumed = pos + 1;
+            if (message.empty()) {
+                std::cout << "Получено пустое сообщение от сервера" << std::endl;
+                continue;
+            }
+            on_line(message);
+        }
+        recv_buffer.erase(0, consumed);
+    }
+
+private:
+    bool read_socket() {
+        char buffer[1024];
+        while (true) {
+            int n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n == 0) {
+                return false;
+            }
+            if (n < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            feed(buffer, n);
+        }
+    }
+
+private:
+    int fd;
+    std::function<void(std::string_view)> on_line;
+    std::string recv_buffer;
+    std::deque<std::coroutine_handle<>> ready;
+    std::multimap<Clock::time_point, std::function<void()>> timers;
+};
+
+// Событие, которого ждут корутины. Не запоминает срабатывание: ждущий проверяет условие сам
+// перед co_await, а обработчики сообщений вызываются только пока корутины приостановлены.
+class Signal {
+public:
+    explicit Signal(EventLoop& loop) : loop(loop) {}
+
+    void notify() {
+        for (auto& waiter : waiters) {
+            if (!waiter->fired) {
+                waiter->fired = true;
+                loop.schedule(waiter->handle);
+            }
+        }
+        waiters.clear();
+    }
+
+    struct Awaiter {
+        Signal& signal;
+        EventLoop::Clock::duration timeout; // ноль - ждать без ограничения
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            auto waiter = std::make_shared<Waiter>();
+            waiter->handle = h;
+            signal.waiters.push_back(waiter);
+            if (timeout > EventLoop::Clock::duration::zero()) {
+                EventLoop& loop = signal.loop;
+                loop.add_timer(EventLoop::Clock::now() + timeout, [waiter, &loop]() {
+                    if (!waiter->fired) {
+                        waiter->fired = true;
+                        loop.schedule(waiter->handle);
+                    }
+                });
+            }
+        }
+        void await_resume() {}
+    };
+
+    Awaiter wait() { return Awaiter{*this, EventLoop::Clock::duration::zero()}; }
+    Awaiter wait_for(EventLoop::Clock::duration timeout) { return Awaiter{*this, timeout}; }
+
+private:
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        bool fired = false;
+    };
+
+    EventLoop& loop;
+    std::vector<std::shared_ptr<Waiter>> waiters;
+};
+
+// Пул потоков для параллельной проверки чужих программ (режим --workers N).
+// Основной поток только складывает сюда ID авторов и продолжает писать свой код,
+// а потоки пула проверяют программы независимо друг от друга.
+class ReviewPool {
+public:
+    void start(int workers_count, int my_id, uint64_t seed) {
+        this->my_id = my_id;
+        this->seed = seed;
+        // SIGINT доставляется основному потоку, чтобы прервать его poll
+        sigset_t sigint_set, previous;
+        sigemptyset(&sigint_set);
+        sigaddset(&sigint_set, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &sigint_set, &previous);
+        for (int i = 0; i < workers_count; i++) {
+            workers.emplace_back([this, i]() { worker_loop(i); });
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    }
+
+    bool enabled() const {
+        return !workers.empty();
+    }
+
+    void submit(const LocalJob& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push(job);
+        }
+        std::cout << "Проверка кода от клиента ID:" << job.peer_id << " передана в пул (в очереди: "
+                  << pending_count() << ")" << std::endl;
+        cv.notify_one();
+    }
+
+    size_t pending_count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending.size();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+private:
+    void worker_loop(int worker_index) {
+        // У каждого потока свой генератор: поток 0 - основной, потоки пула - 1..N
+        seed_thread_rng(seed, worker_index + 1);
+        while (true) {
+            LocalJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return stopped || !pending.empty(); });
+                if (stopped) {
+                    return;
+                }
+                job = pending.front();
+                pending.pop();
+            }
+
+            int author_id = job.peer_id;
+            std::cout << "[Проверяющий #" << worker_index << "] Начинаю проверку кода от клиента ID:" << author_id << std::endl;
+            state_clock.review_started();
+            std::this_thread::sleep_for(std::chrono::duration<double>(job.duration));
+            state_clock.review_finished();
+            int result = draw_verdict();
+            std::string result_str = (result == 1) ? "ПРИНЯТО" : "ОТКЛОНЕНО";
+            std::cout << "[Проверяющий #" << worker_index << "] Завершена проверка кода от клиента ID:" << author_id
+                      << ", результат: " << result_str << std::endl;
+            send_message(socket_fd, REVIEW_RESULT, author_id, my_id, result);
+            session.complete(job.seq);
+            policy_stats.add_review(seconds_since(job.arrived));
+        }
+    }
+
+    int my_id = -1;
+    uint64_t seed = 0;
+    bool stopped = false;
+    std::vector<std::thread> workers;
+    std::queue<LocalJob> pending;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+ReviewPool review_pool;
+
+// Проверка в основном потоке: пока идет ожидание, цикл событий продолжает принимать сообщения
+Task run_review(EventLoop& loop, LocalJob job, int my_id) {
+    std::cout << "Начинаю проверку кода от клиента ID:" << job.peer_id << std::endl;
+    state_clock.set_main(STATE_REVIEWING);
+    co_await loop.sleep(seconds_to_duration(job.duration));
+    state_clock.set_main(STATE_SLEEPING);
+    std::cout << "Завершена проверка кода от клиента ID:" << job.peer_id << std::endl;
+    int result = draw_verdict();
+    std::string result_str = (result == 1) ? "ПРИНЯТО" : "ОТКЛОНЕНО";
+    std::cout << "Результат проверки: " << result_str << std::endl;
+    send_message(socket_fd, REVIEW_RESULT, job.peer_id, my_id, result);
+    std::cout << "Результат проверки отправлен на сервер" << std::endl;
+    session.complete(job.seq);
+    policy_stats.add_review(seconds_since(job.arrived));
+}
+
+// Состояние клиента, общее для обработчика сообщений сервера и корутины программиста
+struct Client {
+    EventLoop& loop;
+    int my_id;
+    Signal queue_reply;   // пришел ответ на запрос очереди
+    Signal work_arrived;  // пришла чужая программа или заключение по своей
+    bool queue_reply_ready = false;
+    int queue_task_from = -1;
+    // Последняя известная нагрузка проверяющих (строки load от сервера)
+    ReviewerLoad loads[3];
+    // Новые значения параметров от администратора, применяются на границе фаз
+    std::vector<std::pair<std::string, std::string> > pending_params;
+
+    Client(EventLoop& loop, int my_id) : loop(loop), my_id(my_id), queue_reply(loop), work_arrived(loop) {}
+};
+
+// Обработчик строк от сервера. Вызывается циклом событий в любой фазе работы программиста,
+// поэтому проверки и заключения попадают в набор работ сразу, а не после окончания написания кода.
+void handle_server_message(Client& client, std::string_view message) {
+    ParsedMessage parsed;
+    if (!parse_message(message, parsed) && parsed.command != Command::PARAM && parsed.command != Command::BUSY) {
+        parsed.command = Command::UNKNOWN;
+    }
+    const long long* args = parsed.args;
+    switch (parsed.command) {
+    case Command::PARAM: {
+        std::string name(message_word(message, 1));
+        std::string value(message_word(message, 2));
+        std::cout << "Получен новый параметр " << name << " = " << value << ", будет применен на границе фаз" << std::endl;
+        client.pending_params.emplace_back(name, value);
+        break;
+    }
+    case Command::BUSY: {
+        // Сервер отклонил наше сообщение по лимиту: запросы и заключения повторяем через секунду,
+        // запрос очереди считаем пустым ответом, а ack и stats накопительные и уйдут со следующим
+        std::string original(message.substr(message.find(' ') + 1));
+        ParsedMessage rejected;
+        parse_message(original, rejected);
+        std::cout << "Сервер занят, сообщение \"" << original << "\" отклонено" << std::endl;
+        if (rejected.command == Command::CHECK || rejected.command == Command::REVIEWED) {
+            client.loop.add_timer(EventLoop::Clock::now() + BUSY_RETRY_DELAY, [original]() {
+                std::string line = original + "\n";
+                std::lock_guard<std::mutex> lock(send_mutex);
+                send_all(socket_fd, line.data(), line.size());
+            });
+        } else if (rejected.command == Command::QUEUE) {
+            client.loop.add_timer(EventLoop::Clock::now() + BUSY_RETRY_DELAY, [&client]() {
+                client.queue_task_from = -1;
+                client.queue_reply_ready = true;
+                client.queue_reply.notify();
+            });
+        }
+        break;
+    }
+    case Command::LOAD: {
+        if (parsed.count < 3 || args[0] < 0 || args[0] >= 3) {
+            break;
+        }
+        ReviewerLoad& load = client.loads[args[0]];
+        load.depth = args[1];
+        load.wait_ms = args[2];
+        load.updated = std::chrono::steady_clock::now();
+        load.known = true;
+        break;
+    }
+    case Command::QUEUE: {
+        client.queue_task_from = args[0];
+        client.queue_reply_ready = true;
+        client.queue_reply.notify();
+        break;
+    }
+    case Command::CHECK: {
+        int id_from = args[1];
+        unsigned long long seq = args[2];
+        if (seq != 0 && !session.accept(seq)) {
+            std::cout << "Повтор сообщения #" << seq << " пропущен" << std::endl;
+            return;
+        }
+        std::cout << "Получен запрос на проверку кода от клиента ID:" << id_from << std::endl;
+        add_job(REVIEW_JOB, id_from, -1, seq);
+        if (review_pool.enabled()) {
+            // Пул проверяет параллельно, поэтому отдаем ему проверку не дожидаясь конца текущей фазы
+            review_pool.submit(take_job(jobs.size() - 1));
+        }
+        client.work_arrived.notify();
+        break;
+    }
+    case Command::REVIEWED: {
+        int id_from = args[1];
+        int result = args[2];
+        unsigned long long seq = args[3];
+        if (seq != 0 && !session.accept(seq)) {
+            std::cout << "Повтор сообщения #" << seq << " пропущен" << std::endl;
+            return;
+        }
+        std::cout << "Получен результат проверки моего кода от клиента ID:" << id_from << std::endl;
+        add_job(VERDICT_JOB, id_from, result, seq);
+        client.work_arrived.notify();
+        break;
+    }
+    default:
+        std::cout << "Неизвестное сообщение от сервера: \"" << message << "\"" << std::endl;
+        break;
+    }
+}
+
+// Применение параметров от администратора. Вызывается только между фазами, чтобы текущее
+// написание или проверка доработали со старыми значениями.
+void apply_pending_params(Client& client) {
+    for (const auto& param : client.pending_params) {
+        std::string error;
+        bool applied;
+        {
+            std::lock_guard<std::mutex> lock(model_mutex);
+            applied = model.set(param.first, param.second, error);
+        }
+        if (applied) {
+            std::cout << "Применен параметр " << param.first << " = " << param.second << std::endl;
+        } else {
+            std::cout << "Параметр не применен: " << error << std::endl;
+        }
+    }
+    client.pending_params.clear();
+}
+
+// Подключение к серверу, -1 при ошибке
+int connect_to_server(const std::string& host_address, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
     struct sockaddr_in server_addr;
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(port);
     server_addr.sin_addr.s_addr = inet_addr(host_address.c_str());
-
-    if (connect(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        std::cerr << "Ошибка подключения к серверу" << std::endl;
-        return 1;
+    if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        close(fd);
+        return -1;
     }
-    std::cout << "Соединение установлено" << std::endl;
+    return fd;
+}
 
-    // Отправка сообщения о том, что это клиент
-    std::string client_message;
-    if (is_reconnect) {
-        client_message = "client " + std::to_string(passed_id) + "\n";
-    } else {
-        client_message = "client\n";
+// Отправка приветствия и чтение ответа start/break. Вслед за start сервер может сразу
+// повторить неподтвержденные сообщения, они возвращаются в leftover.
+// С --department приветствию предшествует строка "department <номер>" для сервера отделов.
+void handshake(int fd, const LineBuffer& hello, ParsedMessage& start, std::string& leftover) {
+    if (department >= 0) {
+        LineBuffer department_line;
+        department_line << Command::DEPARTMENT << ' ' << department << '\n';
+        send(fd, department_line.data(), department_line.size(), 0);
     }
-    send(socket_fd, client_message.c_str(), client_message.length(), 0);
+    send(fd, hello.data(), hello.size(), 0);
 
     char buffer[1024];
-    int n = recv(socket_fd, buffer, sizeof(buffer), 0);
-    std::string message(buffer, n);
+    int n = recv(fd, buffer, sizeof(buffer), 0);
+    std::string message(buffer, n > 0 ? n : 0);
+    size_t start_end = message.find('\n');
+    if (start_end != std::string::npos) {
+        leftover = message.substr(start_end + 1);
+        message.erase(start_end);
+    }
     std::cout << "Сообщение от сервера: \"" << message << "\"" << std::endl;
-    std::istringstream iss(message);
-    std::string cmd;
-    int id;
-    iss >> cmd >> id;
+    parse_message(message, start);
+}
 
-    if (cmd == "start") {
-        std::cout << "Клиент ID: " << id << " запущен" << std::endl;
-    } else if (cmd == "break") {
-        break_flag = 0;
-        std::cout << "Клиент ID: " << id << " завершен" << std::endl;
-        return 0;
+// Переключение на резервный сервер после обрыва соединения: сессия продолжается с тем же
+// токеном, и резервный сервер повторяет неподтвержденные сообщения. Резервному серверу нужно
+// время, чтобы заметить отказ основного, поэтому подключение повторяется до 10 секунд.
+bool fail_over(EventLoop& loop, Client& client, const std::string& host_address, int port) {
+    for (int attempt = 0; attempt < 50 && break_flag; attempt++) {
+        int fd = connect_to_server(host_address, port);
+        if (fd < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            continue;
+        }
+        LineBuffer hello;
+        hello << Command::CLIENT << ' ' << client.my_id << ' ' << session.get_token() << ' ' << session.get_acked_seq() << '\n';
+        ParsedMessage start;
+        std::string leftover;
+        handshake(fd, hello, start, leftover);
+        if (start.command != Command::START) {
+            close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            continue;
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags != -1) {
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        }
+        {
+            std::lock_guard<std::mutex> lock(send_mutex);
+            close(socket_fd);
+            socket_fd = fd;
+        }
+        loop.set_fd(fd);
+        std::cout << "Переключился на резервный сервер " << host_address << ":" << port
+                  << ", сессия продолжена с сообщения #" << session.get_acked_seq() + 1 << std::endl;
+        loop.feed(leftover.data(), leftover.size());
+        // Ответ на запрос очереди мог потеряться вместе со старым соединением
+        client.queue_task_from = -1;
+        client.queue_reply_ready = true;
+        client.queue_reply.notify();
+        return true;
     }
+    return false;
+}
 
-    int my_id = id;
-    std::cout << "Мой ID: " << my_id << std::endl;
+// Жизненный цикл программиста: написание, отправка на проверку, ожидание с выполнением работ
+bool all_overloaded(const Client& client, int my_id) {
+    for (int id = 0; id < 3; id++) {
+        if (id != my_id && !client.loads[id].overloaded()) {
+            return false;
+        }
+    }
+    return true;
+}
 
+Task programmer(Client& client) {
+    EventLoop& loop = client.loop;
+    int my_id = client.my_id;
     bool need_new_checker = true;
     int last_checker_id = -1;
+    double write_seconds = model.write_time.sample(thread_rng());
+    auto cycle_start = std::chrono::steady_clock::now();
 
     while (break_flag) {
         std::cout << "\nНовая итерация кодирования" << std::endl;
+        apply_pending_params(client);
+        if (need_new_checker) {
+            cycle_start = std::chrono::steady_clock::now();
+        }
         std::cout << "Идет написание кода..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(rand() % 10 + 1));
+        state_clock.set_main(STATE_WRITING);
+        co_await loop.sleep(seconds_to_duration(write_seconds));
+        state_clock.set_main(STATE_SLEEPING);
         std::cout << "Код написан" << std::endl;
 
         int checker_id;
 
         if (need_new_checker) {
-            checker_id = rand() % 3;
-            while (checker_id == my_id) {
-                checker_id = rand() % 3;
+            // Если все проверяющие перегружены, новая программа ждет, а программист пока проверяет чужие
+            auto defer_start = std::chrono::steady_clock::now();
+            while (break_flag && all_overloaded(client, my_id) && seconds_since(defer_start) < MAX_DEFER_SECONDS) {
+                std::cout << "Все проверяющие перегружены, откладываю отправку программы" << std::endl;
+                LocalJob job;
+                if (take_next_review(work_policy, job)) {
+                    if (review_pool.enabled()) {
+                        review_pool.submit(job);
+                    } else {
+                        co_await run_review(loop, job, my_id);
+                    }
+                } else {
+                    co_await client.work_arrived.wait_for(std::chrono::seconds(1));
+                }
+            }
+
+            // Перегруженных проверяющих пропускаем; если перегружены все, выбираем наименее загруженного
+            if (all_overloaded(client, my_id)) {
+                checker_id = -1;
+                for (int id = 0; id < 3; id++) {
+                    if (id != my_id && (checker_id == -1 || client.loads[id].wait_ms < client.loads[checker_id].wait_ms)) {
+                        checker_id = id;
+                    }
+                }
+            } else {
+                checker_id = thread_rng().below(3);
+                while (checker_id == my_id || client.loads[checker_id].overloaded()) {
+                    checker_id = thread_rng().below(3);
+                }
+            }
+            if (client.loads[checker_id].known) {
+                std::cout << "Ожидание проверки у ID:" << checker_id << " по оценке сервера: "
+                          << client.loads[checker_id].wait_ms / 1000.0 << " с (в очереди "
+                          << client.loads[checker_id].depth << ")" << std::endl;
             }
             last_checker_id = checker_id;
             need_new_checker = false;
         } else {
+            // Исправленную программу проверяет тот же проверяющий, как бы он ни был загружен
             checker_id = last_checker_id;
         }
 
         std::cout << "Выбираю проверяющего с ID:" << checker_id << std::endl;
 
-        std::string message_to_send = "check " + std::to_string(checker_id) + " " + std::to_string(my_id);
-        message_to_send += "\n";
-        send(socket_fd, message_to_send.c_str(), message_to_send.size(), 0);
+        send_message(socket_fd, REQUEST_CHECK, checker_id, my_id, 0);
 
         std::cout << "Запрос на проверку отправлен клиенту ID:" << checker_id << std::endl;
 
-        int last_checker_id = checker_id;
         bool waiting = true;
 
         std::cout << "Жду результат проверки и обрабатываю задачи..." << std::endl;
 
         while (waiting && break_flag) {
-            std::string message_to_send = "queue " + std::to_string(my_id);
-            message_to_send += "\n";
-            send(socket_fd, message_to_send.c_str(), message_to_send.size(), 0);
+            client.queue_reply_ready = false;
+            send_message(socket_fd, GET_QUEUE, my_id, 0, 0);
 
             std::cout << "Запрос к серверу на получение задач из очереди" << std::endl;
 
-            std::string recv_buffer;
-
-            while (waiting) {
-                char buffer[1024];
-                int n = recv(socket_fd, buffer, sizeof(buffer), 0);
-                if (n <= 0) {
-                    std::cout << "Сервер отключился или произошла ошибка чтения" << std::endl;
-                    break_flag = 0;
-                    break;
-                }
-                recv_buffer.append(buffer, n);
-                size_t pos = 0;
-                while ((pos = recv_buffer.find('\n')) != std::string::npos) {
-                    message = recv_buffer.substr(0, pos);
-                    recv_buffer.erase(0, pos + 1);
-                    if (message.empty()) {
-                        std::cout << "Получено пустое сообщение от сервера" << std::endl;
-                        continue;
-                    }
-                    if (message.substr(0, 5) == "queue") {
-                        break;
-                    } else {
-                        tasks.push(message);
-                    }
-                }
-                
-                if (!message.empty() && message.substr(0, 5) == "queue") {
-                    break;
-                }
-                
+            while (!client.queue_reply_ready) {
+                co_await client.queue_reply.wait();
             }
 
-            std::istringstream iss(message);
-            std::string cmd;
-            int id_to, id_from;
-            iss >> cmd >> id_to >> id_from;
-            if (id_to == -1) {
+            if (client.queue_task_from != -1) {
+                add_job(REVIEW_JOB, client.queue_task_from, -1);
+            } else if (jobs.empty()) {
                 std::cout << "Жду результата моей проверки..." << std::endl;
-                std::this_thread::sleep_for(std::chrono::seconds(5)); 
-            } else {
-                std::cout << "Начинаю проверку кода от клиента ID:" << id_to << std::endl;
-                std::this_thread::sleep_for(std::chrono::seconds(rand() % 10 + 1));
-                std::cout << "Завершена проверка кода от клиента ID:" << id_to << std::endl;
-                int result = rand() % 2;
-                std::string result_str = (result == 1) ? "ПРИНЯТО" : "ОТКЛОНЕНО";
-                std::cout << "Результат проверки: " << result_str << std::endl;
-                send_message(socket_fd, REVIEW_RESULT, id_to, my_id, result);
+                // Просыпаемся сразу, как только придет проверка или заключение
+                co_await client.work_arrived.wait_for(std::chrono::seconds(5));
             }
             
-            if (!tasks.empty()) {
-                std::cout << "Обрабатываю задачи, полученные во время ожидания (" << tasks.size() << " шт.)" << std::endl;
+            if (!jobs.empty()) {
+                std::cout << "Обрабатываю задачи, полученные во время ожидания (" << jobs.size() << " шт.)" << std::endl;
             }
             
-            while (!tasks.empty()) {
-                std::string message = tasks.front();
-                tasks.pop();
-                if (message.substr(0, 5) == "check") {
-                    std::istringstream iss(message);
-                    std::string cmd;
-                    int id_to, id_from;
-                    iss >> cmd >> id_to >> id_from;
-                    std::cout << "Получен запрос на проверку кода от клиента ID:" << id_from << std::endl;
-                    std::this_thread::sleep_for(std::chrono::seconds(rand() % 10 + 1));
-                    std::cout << "Завершена проверка кода от клиента ID:" << id_from << std::endl;
-                    int result = rand() % 2;
-                    std::string result_str = (result == 1) ? "ПРИНЯТО" : "ОТКЛОНЕНО";
-                    std::cout << "Результат проверки: " << result_str << std::endl;
-                    send_message(socket_fd, REVIEW_RESULT, id_from, my_id, result);
-                    std::cout << "Результат проверки отправлен на сервер" << std::endl;
-
-                } else if (message.substr(0, 8) == "reviewed") {
-                    std::istringstream iss(message);
-                    std::string cmd;
-                    int id_to, id_from, result;
-                    iss >> cmd >> id_to >> id_from >> result;
-                    std::cout << "Получен результат проверки моего кода от клиента ID:" << id_from << std::endl;
-                    if (result == 0) {
-                        std::cout << "Проверка не пройдена! Нужно исправить код" << std::endl;
-                        need_new_checker = false;
-                        waiting = false;
-                        std::cout << "Начинаю переписывать код..." << std::endl;
-                        break;
+            while (!jobs.empty() && waiting) {
+                apply_pending_params(client);
+                LocalJob job = take_next_job(work_policy);
+                if (job.kind == VERDICT_JOB) {
+                    session.complete(job.seq);
+                    // Сервер мог переназначить проверку, исправление уходит тому, кто ее выполнил
+                    last_checker_id = job.peer_id;
+                }
+                if (job.kind == REVIEW_JOB) {
+                    if (review_pool.enabled()) {
+                        review_pool.submit(job);
                     } else {
-                        std::cout << "Проверка пройдена успешно!" << std::endl;
-                        waiting = false;
-                        need_new_checker = true;
-                        break;
+                        co_await run_review(loop, job, my_id);
                     }
+                } else if (job.result == 0) {
+                    std::cout << "Проверка не пройдена! Нужно исправить код" << std::endl;
+                    need_new_checker = false;
+                    waiting = false;
+                    write_seconds = job.duration;
+                    std::cout << "Начинаю переписывать код..." << std::endl;
+                } else {
+                    std::cout << "Проверка пройдена успешно!" << std::endl;
+                    waiting = false;
+                    need_new_checker = true;
+                    write_seconds = job.duration;
+                    policy_stats.add_cycle(seconds_since(cycle_start));
+                    policy_stats.print(work_policy);
                 }
             }
         }
     }
+}
 
+// Периодическая отправка времени по состояниям, чтобы сервер видел и долгий сон без смены фаз
+Task state_reporter(EventLoop& loop, int my_id) {
+    while (break_flag) {
+        co_await loop.sleep(std::chrono::seconds(STATE_REPORT_SECONDS));
+        send_state_report(socket_fd, my_id);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    bool is_reconnect = false;
+    int passed_id = -1;
+    int workers_count = 0;
+    std::string failover_address;
+    bool max_wait_set = false;
+    // По умолчанию зерно различается даже у клиентов, запущенных в одну секунду
+    uint64_t seed = (static_cast<uint64_t>(time(NULL)) << 20) ^ getpid();
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if ((strcmp(argv[i], "--write-dist") == 0 || strcmp(argv[i], "--review-dist") == 0) && i + 1 < argc) {
+            Distribution& target = strcmp(argv[i], "--write-dist") == 0 ? model.write_time : model.review_time;
+            if (!Distribution::parse(argv[++i], target)) {
+                std::cerr << "Неверное распределение: " << argv[i]
+                          << ". Допустимые: uniform:a:b, exp:mean, lognormal:mu:sigma, const:x" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--accept") == 0 && i + 1 < argc) {
+            model.accept_probability = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-wait") == 0 && i + 1 < argc) {
+            max_wait_seconds = atof(argv[++i]);
+            max_wait_set = true;
+        } else if (strcmp(argv[i], "--department") == 0 && i + 1 < argc) {
+            department = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--failover") == 0 && i + 1 < argc && strchr(argv[i + 1], ':') != NULL) {
+            failover_address = argv[++i];
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            if (!parse_policy(argv[++i], work_policy)) {
+                std::cerr << "Неизвестная политика: " << argv[i] << ". Допустимые: oldest, reviews-first, fix-first, shortest" << std::endl;
+                return 1;
+            }
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() < 2 || positional.size() > 3 || workers_count < 0 || department < -1
+        || model.accept_probability < 0 || model.accept_probability > 1) {
+        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт сервера> [id] [--workers N] [--policy P]"
+                  << " [--seed S] [--write-dist D] [--review-dist D] [--accept P] [--failover <адрес>:<порт>]"
+                  << " [--max-wait S] [--department N]" << std::endl;
+        return 1;
+    }
+    // Сервер отделов не отправляет отчеты о нагрузке и не имеет резервного сервера
+    if (department != -1 && (max_wait_set || !failover_address.empty())) {
+        std::cerr << "С --department нельзя использовать --max-wait и --failover: сервер отделов"
+                  << " не отправляет отчеты о нагрузке и не поддерживает резервный сервер" << std::endl;
+        return 1;
+    }
+    if (positional.size() == 3) {
+        is_reconnect = true;
+        passed_id = atoi(positional[2].c_str());
+    }
+
+    seed_thread_rng(seed, 0);
+    struct sigaction sa;
+    sa.sa_handler = &sigint_handler;
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string host_address = positional[0];
+    int port = atoi(positional[1].c_str());
+
+    socket_fd = connect_to_server(host_address, port);
+    if (socket_fd < 0) {
+        std::cerr << "Ошибка подключения к серверу" << std::endl;
+        return 1;
+    }
+    std::cout << "Соединение установлено" << std::endl;
+
+    // Отправка сообщения о том, что это клиент
+    LineBuffer client_message;
+    client_message << Command::CLIENT;
+    if (is_reconnect && session.load(passed_id)) {
+        // Возобновление сессии: сервер повторит сообщения после последнего подтвержденного
+        client_message << ' ' << passed_id << ' ' << session.get_token() << ' ' << session.get_acked_seq();
+        std::cout << "Возобновляю сессию ID:" << passed_id << " с сообщения #" << session.get_acked_seq() + 1 << std::endl;
+    } else if (is_reconnect) {
+        client_message << ' ' << passed_id;
+    }
+    client_message << '\n';
+
+    ParsedMessage start;
+    std::string leftover;
+    handshake(socket_fd, client_message, start, leftover);
+    int id = start.args[0];
+    unsigned long long token = static_cast<unsigned long long>(start.args[1]);
+
+    if (start.command == Command::START) {
+        std::cout << "Клиент ID: " << id << " запущен" << std::endl;
+    } else if (start.command == Command::BREAK) {
+        break_flag = 0;
+        std::cout << "Клиент ID: " << id << " завершен" << std::endl;
+        return 0;
+    }
+
+    int my_id = id;
+    std::cout << "Мой ID: " << my_id << std::endl;
+    session.start(my_id, token);
+
+    if (workers_count > 0) {
+        review_pool.start(workers_count, my_id, seed);
+        std::cout << "Запущен пул проверяющих потоков: " << workers_count << " шт." << std::endl;
+    }
+    std::cout << "Политика выбора работы: " << policy_names[work_policy] << std::endl;
+    std::cout << "Модель: зерно " << seed << ", написание " << model.write_time.describe()
+              << ", проверка " << model.review_time.describe() << ", вероятность принятия " << model.accept_probability << std::endl;
+
+    // Дальше сокет работает в неблокирующем режиме под управлением цикла событий
+    int flags = fcntl(socket_fd, F_GETFL, 0);
+    if (flags != -1) {
+        fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    Client* client_ptr = nullptr;
+    EventLoop loop(socket_fd, [&client_ptr](std::string_view line) {
+        handle_server_message(*client_ptr, line);
+    });
+    Client client(loop, my_id);
+    client_ptr = &client;
+    loop.feed(leftover.data(), leftover.size());
+
+    Task programmer_task = programmer(client);
+    programmer_task.start();
+    Task reporter_task = state_reporter(loop, my_id);
+    reporter_task.start();
+    while (break_flag && !programmer_task.done()) {
+        if (!loop.run_once()) {
+            std::cout << "Сервер отключился или произошла ошибка чтения" << std::endl;
+            if (!failover_address.empty()) {
+                size_t colon = failover_address.rfind(':');
+                std::string failover_host = failover_address.substr(0, colon);
+                int failover_port = atoi(failover_address.c_str() + colon + 1);
+                if (fail_over(loop, client, failover_host, failover_port)) {
+                    // Резервным становится прежний сервер, если его перезапустят
+                    failover_address = host_address + ":" + std::to_string(port);
+                    host_address = failover_host;
+                    port = failover_port;
+                    continue;
+                }
+                std::cout << "Резервный сервер недоступен" << std::endl;
+            }
+            break_flag = 0;
+        }
+    }
+
+    if (interrupted) {
+        std::cout << "SIGINT получен. Подготовка к завершению программы..." << std::endl;
+    }
+    review_pool.stop();
+    send_state_report(socket_fd, my_id);
+    policy_stats.print(work_policy);
+    state_clock.print();
     close(socket_fd);
     std::cout << "Клиент ID:" << my_id << " завершает работу...\n";
     return 0;
@@ -0,0 +1,55 @@
+// Проверка отложенной отправки программы в клиенте: пока все проверяющие перегружены, клиент берет
+// из локальной очереди только чужие проверки. Заключение по своей программе, пришедшее во время
+// ожидания, должно остаться в очереди при любой политике, иначе оно будет "проверено" и потеряно.
+// Код возврата 0 - заключения не терялись.
+
+#define main client_main
+#include "client_10.cpp"
+#undef main
+
+bool check_policy(WorkPolicy policy) {
+    jobs.clear();
+    // Заключение пришло раньше проверок и короче их: его выбрали бы oldest, fix-first и shortest
+    add_job(VERDICT_JOB, 1, 0, 7);
+    jobs.back().duration = 0.01;
+    add_job(REVIEW_JOB, 2, -1, 8);
+    add_job(REVIEW_JOB, 1, -1, 9);
+
+    // Так же, как цикл ожидания в programmer, разбираем очередь до конца
+    int reviews = 0;
+    LocalJob job;
+    while (take_next_review(policy, job)) {
+        if (job.kind != REVIEW_JOB) {
+            std::cout << "ОШИБКА: политика " << policy_names[policy] << " выдала заключение во время ожидания" << std::endl;
+            return false;
+        }
+        reviews++;
+    }
+    if (reviews != 2 || jobs.size() != 1 || jobs.front().kind != VERDICT_JOB || jobs.front().seq != 7) {
+        std::cout << "ОШИБКА: политика " << policy_names[policy] << ": проверок взято " << reviews
+                  << ", осталось работ " << jobs.size() << std::endl;
+        return false;
+    }
+
+    // После отправки программы обычный путь забирает заключение
+    job = take_next_job(policy);
+    if (job.kind != VERDICT_JOB || job.seq != 7 || !jobs.empty()) {
+        std::cout << "ОШИБКА: политика " << policy_names[policy] << ": заключение не дошло до обычного пути" << std::endl;
+        return false;
+    }
+    std::cout << "Политика " << policy_names[policy] << ": проверок во время ожидания " << reviews
+              << ", заключение сохранено" << std::endl;
+    return true;
+}
+
+int main() {
+    bool ok = true;
+    for (int i = 0; i <= SHORTEST_FIRST; i++) {
+        ok = check_policy(static_cast<WorkPolicy>(i)) && ok;
+    }
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -10,6 +10,18 @@
 #include <iomanip>
 #include <sstream>
 #include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <charconv>
 
 volatile sig_atomic_t break_flag = 1;
 
@@ -26,14 +38,711 @@ std::string getCurrentTime() {
     return ss.str();
 }
 
+// Кэш метки времени для потока логов: строка [HH:MM:SS] пересчитывается только при смене секунды.
+// В файлах пишется полная дата [YYYY-MM-DD HH:MM:SS], чтобы по ней можно было искать интервал.
+class TimestampCache {
+public:
+    explicit TimestampCache(bool with_date = false) : with_date(with_date) {}
+
+    const char* get() {
+        time_t now = time(NULL);
+        if (now != cached_second) {
+            std::tm tm_time;
+            localtime_r(&now, &tm_time);
+            if (with_date) {
+                length = snprintf(text, sizeof(text), "[%04d-%02d-%02d %02d:%02d:%02d] ", tm_time.tm_year + 1900,
+                                  tm_time.tm_mon + 1, tm_time.tm_mday, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+            } else {
+                length = snprintf(text, sizeof(text), "[%02d:%02d:%02d] ", tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+            }
+            cached_second = now;
+        }
+        return text;
+    }
+
+    size_t size() const { return length; }
+    time_t second() const { return cached_second; }
+
+private:
+    bool with_date;
+    time_t cached_second = -1;
+    size_t length = 0;
+    char text[32];
+};
+
+// Получатель строк монитора. Строка передается частями через append, конец строки отмечается end_line.
+class LineSink {
+public:
+    virtual ~LineSink() {}
+    virtual void append(const char* data, size_t size) = 0;
+    virtual void end_line(time_t now) {}
+    virtual void flush() = 0;
+};
+
+// Буфер вывода: строки копируются в большой буфер, а в stdout уходят одним write на пачку,
+// без сброса после каждой строки
+class OutputBuffer : public LineSink {
+public:
+    ~OutputBuffer() {
+        flush();
+    }
+
+    void append(const char* data, size_t size) override {
+        if (used + size > sizeof(buffer)) {
+            flush();
+        }
+        if (size > sizeof(buffer)) {
+            write_all(data, size);
+            return;
+        }
+        memcpy(buffer + used, data, size);
+        used += size;
+    }
+
+    void flush() override {
+        write_all(buffer, used);
+        used = 0;
+    }
+
+private:
+    static void write_all(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = write(STDOUT_FILENO, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            data += n;
+            size -= n;
+        }
+    }
+
+    char buffer[1 << 16];
+    size_t used = 0;
+};
+
+// Блок сегмента: сжимается независимо, поэтому из архива можно распаковать только нужные блоки
+struct LogBlock {
+    time_t first_time = 0;
+    time_t last_time = 0;
+    unsigned long long raw_offset = 0;
+    unsigned long long raw_size = 0;
+};
+
+struct SealedSegment {
+    int number;
+    std::vector<LogBlock> blocks;
+};
+
+std::string segment_path(const std::string& dir, int number, const char* extension) {
+    char name[64];
+    snprintf(name, sizeof(name), "/segment_%06d.%s", number, extension);
+    return dir + name;
+}
+
+// Фоновое сжатие закрытых сегментов. Сегмент segment_N.log превращается в segment_N.z (блоки zlib
+// с уровнем Z_BEST_SPEED) и segment_N.idx (строка на блок: время начала и конца, смещение и размеры).
+// В index.txt дописывается строка "N начало конец", по которой чтение находит нужные сегменты.
+class SegmentCompressor {
+public:
+    void start(const std::string& directory) {
+        dir = directory;
+        worker = std::thread([this]() { worker_loop(); });
+    }
+
+    void submit(SealedSegment segment) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push(std::move(segment));
+        }
+        cv.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        cv.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+private:
+    void worker_loop() {
+        while (true) {
+            SealedSegment segment;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return stopped || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                segment = std::move(pending.front());
+                pending.pop();
+            }
+            compress_segment(segment);
+        }
+    }
+
+    void compress_segment(const SealedSegment& segment) {
+        std::string raw_path = segment_path(dir, segment.number, "log");
+        std::ifstream raw(raw_path, std::ios::binary);
+        std::ofstream packed(segment_path(dir, segment.number, "z"), std::ios::binary | std::ios::trunc);
+        std::ofstream index(segment_path(dir, segment.number, "idx"), std::ios::trunc);
+        if (!raw || !packed || !index) {
+            std::cerr << getCurrentTime() << " Не удалось сжать сегмент " << raw_path << std::endl;
+            return;
+        }
+
+        std::vector<char> input;
+        std::vector<unsigned char> output;
+        unsigned long long packed_offset = 0;
+        for (const LogBlock& block : segment.blocks) {
+            input.resize(block.raw_size);
+            raw.seekg(block.raw_offset);
+            raw.read(input.data(), block.raw_size);
+            uLongf packed_size = compressBound(block.raw_size);
+            output.resize(packed_size);
+            int status = compress2(output.data(), &packed_size, reinterpret_cast<const Bytef*>(input.data()),
+                                   block.raw_size, Z_BEST_SPEED);
+            if (!raw || status != Z_OK) {
+                // Сегмент остается несжатым: режим --read читает такие сегменты как текст
+                std::cerr << getCurrentTime() << " Не удалось сжать сегмент " << raw_path << " (zlib: " << status
+                          << "), он сохранен без сжатия" << std::endl;
+                packed.close();
+                index.close();
+                unlink(segment_path(dir, segment.number, "z").c_str());
+                unlink(segment_path(dir, segment.number, "idx").c_str());
+                return;
+            }
+            packed.write(reinterpret_cast<const char*>(output.data()), packed_size);
+            index << block.first_time << " " << block.last_time << " " << packed_offset << " "
+                  << packed_size << " " << block.raw_size << "\n";
+            packed_offset += packed_size;
+        }
+        packed.close();
+        index.close();
+
+        std::ofstream segments(dir + "/index.txt", std::ios::app);
+        segments << segment.number << " " << segment.blocks.front().first_time << " "
+                 << segment.blocks.back().last_time << "\n";
+        segments.close();
+        unlink(raw_path.c_str());
+    }
+
+    std::string dir;
+    bool stopped = false;
+    std::queue<SealedSegment> pending;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+};
+
+// Запись логов в файлы с ротацией по размеру или времени (режим --file).
+// Текущий сегмент пишется как обычный текст, закрытые сегменты сжимаются в фоне.
+class FileSink : public LineSink {
+public:
+    static const unsigned long long BLOCK_SIZE = 256 * 1024;
+
+    FileSink(const std::string& dir, unsigned long long max_segment_bytes, time_t max_segment_seconds)
+        : dir(dir), max_segment_bytes(max_segment_bytes), max_segment_seconds(max_segment_seconds) {}
+
+    ~FileSink() {
+        close();
+    }
+
+    bool open() {
+        mkdir(dir.c_str(), 0755);
+        // Нумерация продолжается после уже существующих сегментов
+        if (DIR* d = opendir(dir.c_str())) {
+            while (struct dirent* entry = readdir(d)) {
+                int number;
+                if (sscanf(entry->d_name, "segment_%d.", &number) == 1 && number >= next_number) {
+                    next_number = number + 1;
+                }
+            }
+            closedir(d);
+        }
+        compressor.start(dir);
+        return open_segment();
+    }
+
+    void append(const char* data, size_t size) override {
+        // Без открытого сегмента строки теряются до успешного открытия следующего
+        if (!file) {
+            return;
+        }
+        fwrite(data, 1, size, file);
+        segment_bytes += size;
+        block.raw_size += size;
+    }
+
+    void end_line(time_t now) override {
+        if (!file) {
+            // Повторная попытка открыть сегмент не чаще раза в секунду
+            if (now != last_open_attempt) {
+                last_open_attempt = now;
+                open_segment();
+            }
+            return;
+        }
+        if (block.first_time == 0) {
+            block.first_time = now;
+        }
+        block.last_time = now;
+        if (segment_opened == 0) {
+            segment_opened = now;
+        }
+        if (block.raw_size >= BLOCK_SIZE) {
+            close_block();
+        }
+        if (segment_bytes >= max_segment_bytes || (max_segment_seconds > 0 && now - segment_opened >= max_segment_seconds)) {
+            seal_segment();
+            open_segment();
+        }
+    }
+
+    void flush() override {
+        if (file) {
+            fflush(file);
+        }
+    }
+
+    void close() {
+        if (file) {
+            seal_segment();
+        }
+        compressor.stop();
+    }
+
+private:
+    bool open_segment() {
+        file = fopen(segment_path(dir, next_number, "log").c_str(), "wb");
+        if (!file) {
+            std::cerr << getCurrentTime() << " Не удалось открыть сегмент " << segment_path(dir, next_number, "log")
+                      << ": " << strerror(errno) << ", строки лога не записываются" << std::endl;
+            return false;
+        }
+        number = next_number++;
+        setvbuf(file, NULL, _IOFBF, 1 << 20);
+        segment_bytes = 0;
+        segment_opened = 0;
+        blocks.clear();
+        block = LogBlock();
+        return true;
+    }
+
+    void close_block() {
+        if (block.raw_size == 0) {
+            return;
+        }
+        blocks.push_back(block);
+        LogBlock next;
+        next.raw_offset = block.raw_offset + block.raw_size;
+        block = next;
+    }
+
+    void seal_segment() {
+        close_block();
+        fclose(file);
+        file = nullptr;
+        if (blocks.empty()) {
+            unlink(segment_path(dir, number, "log").c_str());
+            return;
+        }
+        compressor.submit(SealedSegment{number, blocks});
+    }
+
+    std::string dir;
+    unsigned long long max_segment_bytes;
+    time_t max_segment_seconds;
+    SegmentCompressor compressor;
+    FILE* file = nullptr;
+    int number = 0;
+    int next_number = 0;
+    unsigned long long segment_bytes = 0;
+    time_t segment_opened = 0;
+    time_t last_open_attempt = 0;
+    std::vector<LogBlock> blocks;
+    LogBlock block;
+};
+
+// Режим --dashboard: по потоку логов сервера поддерживаются скользящие агрегаты за последние 60 секунд,
+// экран перерисовывается раз в секунду. События берутся из строк "Получено сообщение от клиента"
+// (check/reviewed от клиентов) и "Сообщение клиенту" (выдача задачи из очереди). Каждое событие
+// обновляет счетчики за O(1), раз в секунду выбывает самая старая секунда окна.
+class DashboardSink : public LineSink {
+public:
+    DashboardSink() {
+        line.reserve(1024);
+        start = std::chrono::steady_clock::now();
+    }
+
+    void append(const char* data, size_t size) override {
+        line.append(data, size);
+    }
+
+    void end_line(time_t now) override {
+        double seconds = seconds_now();
+        handle_line(seconds);
+        line.clear();
+        // При непрерывном потоке строк recv не доходит до EAGAIN и flush не вызывается,
+        // поэтому экран раз в секунду перерисовывается и отсюда
+        redraw_if_due(seconds);
+    }
+
+    void flush() override {
+        redraw_if_due(seconds_now());
+    }
+
+private:
+    static const int WINDOW = 60;
+    static const int MAX_PROGRAMMERS = 3; // в отделе три программиста; строки лога сервер пишет до проверки ID
+    static const int WAIT_BUCKETS = 1200; // гистограмма ожидания с шагом 0.1 с до 120 с
+    enum State { WRITING = 0, REVIEWING = 1, SLEEPING = 2 };
+
+    struct Programmer {
+        int queue_depth = 0;
+        int reviewing = 0;
+        bool awaiting_verdict = false;
+        double submitted_at = 0;
+        State state = WRITING;
+        double state_since = 0;
+        double window_time[3] = {0, 0, 0};
+    };
+
+    struct SecondBucket {
+        int accepted = 0;
+        int rejected = 0;
+        std::vector<std::array<double, 3> > state_time;
+        std::vector<int> wait_samples;
+    };
+
+    double seconds_now() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void redraw_if_due(double now) {
+        advance_window(now);
+        if (static_cast<long long>(now) != last_render) {
+            last_render = static_cast<long long>(now);
+            render(now);
+        }
+    }
+
+    static bool valid_id(int id) {
+        return id >= 0 && id < MAX_PROGRAMMERS;
+    }
+
+    Programmer& programmer(int id) {
+        if (id >= static_cast<int>(programmers.size())) {
+            programmers.resize(id + 1);
+            for (auto& bucket : buckets) {
+                bucket.state_time.resize(id + 1, {0, 0, 0});
+            }
+        }
+        return programmers[id];
+    }
+
+    void charge(int id, double now) {
+        Programmer& p = programmer(id);
+        double elapsed = now - p.state_since;
+        if (elapsed > 0) {
+            buckets[current].state_time[id][p.state] += elapsed;
+            p.window_time[p.state] += elapsed;
+        }
+        p.state_since = now;
+    }
+
+    void update_state(int id, double now) {
+        charge(id, now);
+        Programmer& p = programmer(id);
+        p.state = p.reviewing > 0 ? REVIEWING : (p.awaiting_verdict ? SLEEPING : WRITING);
+    }
+
+    // Сдвиг окна: выбывающие секунды вычитаются из сумм окна
+    void advance_window(double now) {
+        long long second = static_cast<long long>(now);
+        if (second == current_second) {
+            return;
+        }
+        for (size_t id = 0; id < programmers.size(); id++) {
+            charge(id, now);
+        }
+        long long steps = std::min<long long>(second - current_second, WINDOW);
+        for (long long i = 0; i < steps; i++) {
+            current = (current + 1) % WINDOW;
+            SecondBucket& bucket = buckets[current];
+            accepted -= bucket.accepted;
+            rejected -= bucket.rejected;
+            for (size_t id = 0; id < bucket.state_time.size(); id++) {
+                for (int s = 0; s < 3; s++) {
+                    programmers[id].window_time[s] -= bucket.state_time[id][s];
+                    bucket.state_time[id][s] = 0;
+                }
+            }
+            for (int sample : bucket.wait_samples) {
+                wait_histogram[sample]--;
+                wait_count--;
+            }
+            bucket.accepted = bucket.rejected = 0;
+            bucket.wait_samples.clear();
+        }
+        current_second = second;
+    }
+
+    // Текст сообщения протокола между кавычками после маркера
+    bool extract(const char* marker, std::string& message) {
+        size_t pos = line.find(marker);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        size_t open_quote = line.find('"', pos);
+        size_t close_quote = open_quote == std::string::npos ? open_quote : line.find('"', open_quote + 1);
+        if (close_quote == std::string::npos) {
+            return false;
+        }
+        message.assign(line, open_quote + 1, close_quote - open_quote - 1);
+        return true;
+    }
+
+    void handle_line(double now) {
+        advance_window(now);
+        std::string message;
+        int a = -1, b = -1, result = -1;
+        if (extract("Получено сообщение от клиента", message)) {
+            if (sscanf(message.c_str(), "check %d %d", &a, &b) == 2 && valid_id(a) && valid_id(b)) {
+                // b отправил программу на проверку a
+                programmer(a).queue_depth++;
+                Programmer& author = programmer(b);
+                author.awaiting_verdict = true;
+                author.submitted_at = now;
+                update_state(b, now);
+            } else if (sscanf(message.c_str(), "reviewed %d %d %d", &a, &b, &result) == 3 && valid_id(a) && valid_id(b)) {
+                // b вернул заключение автору a
+                SecondBucket& bucket = buckets[current];
+                (result == 1 ? bucket.accepted : bucket.rejected)++;
+                (result == 1 ? accepted : rejected)++;
+                Programmer& author = programmer(a);
+                if (author.awaiting_verdict) {
+                    int sample = std::min(WAIT_BUCKETS - 1, static_cast<int>((now - author.submitted_at) * 10));
+                    wait_histogram[sample]++;
+                    wait_count++;
+                    bucket.wait_samples.push_back(sample);
+                    author.awaiting_verdict = false;
+                }
+                update_state(a, now);
+                Programmer& reviewer = programmer(b);
+                reviewer.reviewing = std::max(0, reviewer.reviewing - 1);
+                update_state(b, now);
+            }
+        } else if (extract("Сообщение клиенту", message)) {
+            if (sscanf(message.c_str(), "queue %d %d", &a, &b) == 2 && valid_id(a) && valid_id(b)) {
+                // b получил из очереди программу автора a
+                Programmer& reviewer = programmer(b);
+                reviewer.queue_depth = std::max(0, reviewer.queue_depth - 1);
+                reviewer.reviewing++;
+                update_state(b, now);
+            }
+        }
+    }
+
+    double wait_percentile(double fraction) const {
+        if (wait_count == 0) {
+            return 0;
+        }
+        long long rank = static_cast<long long>(fraction * (wait_count - 1));
+        long long seen = 0;
+        for (int i = 0; i < WAIT_BUCKETS; i++) {
+            seen += wait_histogram[i];
+            if (seen > rank) {
+                return (i + 1) / 10.0;
+            }
+        }
+        return WAIT_BUCKETS / 10.0;
+    }
+
+    void render(double now) {
+        double window = std::min<double>(now, WINDOW);
+        char text[256];
+        std::string screen = "\033[H\033[2J";
+        screen += getCurrentTime() + " Монитор отдела, окно " + std::to_string(static_cast<int>(window)) + " с\n";
+        int reviews = accepted + rejected;
+        snprintf(text, sizeof(text), "Принято программ: %d (%.1f в минуту)\n", accepted, window > 0 ? accepted * 60.0 / window : 0);
+        screen += text;
+        snprintf(text, sizeof(text), "Проверок: %d, принято %d / отклонено %d (%.0f%% принято)\n", reviews, accepted, rejected,
+                 reviews ? accepted * 100.0 / reviews : 0);
+        screen += text;
+        snprintf(text, sizeof(text), "Ожидание проверки: p50 %.1f с, p99 %.1f с (выборка %d)\n\n", wait_percentile(0.5),
+                 wait_percentile(0.99), wait_count);
+        screen += text;
+        screen += "ID   очередь   пишет   проверяет   спит\n";
+        for (size_t id = 0; id < programmers.size(); id++) {
+            const Programmer& p = programmers[id];
+            double total = p.window_time[0] + p.window_time[1] + p.window_time[2];
+            if (total <= 0) {
+                total = 1;
+            }
+            snprintf(text, sizeof(text), "%-5zu%-10d%4.0f%%   %8.0f%%   %3.0f%%\n", id, p.queue_depth,
+                     p.window_time[WRITING] * 100 / total, p.window_time[REVIEWING] * 100 / total,
+                     p.window_time[SLEEPING] * 100 / total);
+            screen += text;
+        }
+        fwrite(screen.data(), 1, screen.size(), stdout);
+        fflush(stdout);
+    }
+
+    std::string line;
+    std::chrono::steady_clock::time_point start;
+    std::vector<Programmer> programmers;
+    SecondBucket buckets[WINDOW];
+    int current = 0;
+    long long current_second = 0;
+    long long last_render = -1;
+    int accepted = 0;
+    int rejected = 0;
+    int wait_histogram[WAIT_BUCKETS] = {};
+    int wait_count = 0;
+};
+
+time_t parse_log_time(const char* text) {
+    std::tm tm_time = {};
+    if (!strptime(text, "%Y-%m-%d %H:%M:%S", &tm_time)) {
+        return -1;
+    }
+    tm_time.tm_isdst = -1;
+    return mktime(&tm_time);
+}
+
+// Целое число из аргумента командной строки в пределах [1, max]. -1, если строка не число или вне пределов.
+long long parse_positive(const char* text, long long max) {
+    long long value = 0;
+    const char* end = text + strlen(text);
+    auto result = std::from_chars(text, end, value);
+    if (result.ec != std::errc() || result.ptr != end || value <= 0 || value > max) {
+        return -1;
+    }
+    return value;
+}
+
+// Вывод строк из интервала [from, to]. Строки файлового режима начинаются с [YYYY-MM-DD HH:MM:SS].
+void print_lines_in_window(const char* data, size_t size, time_t from, time_t to) {
+    const char* begin = data;
+    const char* end = data + size;
+    while (begin < end) {
+        const char* newline = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        const char* line_end = newline ? newline + 1 : end;
+        if (line_end - begin > 21 && begin[0] == '[') {
+            time_t line_time = parse_log_time(begin + 1);
+            if (line_time >= from && line_time <= to) {
+                fwrite(begin, 1, line_end - begin, stdout);
+            }
+        }
+        begin = line_end;
+    }
+}
+
+// Режим --read: по index.txt и индексам сегментов распаковываются только блоки, пересекающие интервал.
+// Еще не сжатые сегменты (текущий или оставшиеся после аварийного завершения) просматриваются целиком.
+int read_window(const std::string& dir, time_t from, time_t to) {
+    std::vector<int> packed_numbers;
+    std::ifstream segments(dir + "/index.txt");
+    int number;
+    long long first_time, last_time;
+    while (segments >> number >> first_time >> last_time) {
+        if (last_time >= from && first_time <= to) {
+            packed_numbers.push_back(number);
+        }
+    }
+
+    std::vector<char> packed;
+    std::vector<char> raw;
+    for (int segment : packed_numbers) {
+        std::ifstream index(segment_path(dir, segment, "idx"));
+        std::ifstream archive(segment_path(dir, segment, "z"), std::ios::binary);
+        unsigned long long offset, packed_size, raw_size;
+        while (index >> first_time >> last_time >> offset >> packed_size >> raw_size) {
+            if (last_time < from || first_time > to) {
+                continue;
+            }
+            packed.resize(packed_size);
+            raw.resize(raw_size);
+            archive.seekg(offset);
+            archive.read(packed.data(), packed_size);
+            uLongf unpacked_size = raw_size;
+            if (uncompress(reinterpret_cast<Bytef*>(raw.data()), &unpacked_size,
+                           reinterpret_cast<const Bytef*>(packed.data()), packed_size) != Z_OK) {
+                std::cerr << "Поврежден блок сегмента " << segment << std::endl;
+                continue;
+            }
+            print_lines_in_window(raw.data(), unpacked_size, from, to);
+        }
+    }
+
+    std::vector<int> raw_numbers;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (struct dirent* entry = readdir(d)) {
+            int segment;
+            char extension[8];
+            if (sscanf(entry->d_name, "segment_%d.%7s", &segment, extension) == 2 && strcmp(extension, "log") == 0) {
+                raw_numbers.push_back(segment);
+            }
+        }
+        closedir(d);
+    }
+    std::sort(raw_numbers.begin(), raw_numbers.end());
+    for (int segment : raw_numbers) {
+        std::ifstream file(segment_path(dir, segment, "log"), std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        print_lines_in_window(content.data(), content.size(), from, to);
+    }
+    fflush(stdout);
+    return 0;
+}
+
 void sigint_handler(int sig) {
     break_flag = 0;
     std::cout << std::endl << getCurrentTime() << " Получен сигнал SIGINT. Завершение работы..." << std::endl;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        std::cerr << getCurrentTime() << " Использование: " << argv[0] << " <адрес_сервера> <порт_сервера>" << std::endl;
+    if (argc == 5 && strcmp(argv[1], "--read") == 0) {
+        time_t from = parse_log_time(argv[3]);
+        time_t to = parse_log_time(argv[4]);
+        if (from < 0 || to < 0) {
+            std::cerr << "Время задается в формате \"YYYY-MM-DD HH:MM:SS\"" << std::endl;
+            return 1;
+        }
+        return read_window(argv[2], from, to);
+    }
+
+    std::string file_dir;
+    long long segment_mb = 64;
+    long long segment_minutes = 60;
+    bool dashboard = false;
+    for (int i = 3; i < argc; i += 2) {
+        if (strcmp(argv[i], "--dashboard") == 0) {
+            dashboard = true;
+            i--;
+        } else if (i + 1 >= argc) {
+            argc = 0;
+        } else if (strcmp(argv[i], "--file") == 0) {
+            file_dir = argv[i + 1];
+        } else if (strcmp(argv[i], "--segment-mb") == 0) {
+            // Ограничения не дают переполниться размеру в байтах и длительности в секундах
+            segment_mb = parse_positive(argv[i + 1], 1LL << 40);
+        } else if (strcmp(argv[i], "--segment-minutes") == 0) {
+            segment_minutes = parse_positive(argv[i + 1], 1LL << 40);
+        } else {
+            argc = 0;
+        }
+    }
+    if (argc < 3 || (dashboard && !file_dir.empty()) || segment_mb < 0 || segment_minutes < 0) {
+        std::cerr << getCurrentTime() << " Использование: " << argv[0] << " <адрес_сервера> <порт_сервера>"
+                  << " [--file <каталог>] [--segment-mb N] [--segment-minutes M] | [--dashboard]" << std::endl
+                  << "       " << argv[0] << " --read <каталог> \"<начало>\" \"<конец>\"" << std::endl;
         return 1;
     }
 
@@ -83,35 +792,79 @@ int main(int argc, char *argv[]) {
     std::cout << getCurrentTime() << " Отправлено идентификационное сообщение: monitor" << std::endl;
 
     char buffer[4096];
-    std::string message_buffer;
+    std::string message_buffer; // начало строки, не закончившейся в предыдущем recv
+    TimestampCache timestamp(!file_dir.empty());
+    OutputBuffer console;
+    FileSink* file_sink = nullptr;
+    if (!file_dir.empty()) {
+        file_sink = new FileSink(file_dir, segment_mb << 20, segment_minutes * 60);
+        if (!file_sink->open()) {
+            std::cerr << getCurrentTime() << " Не удалось открыть каталог логов " << file_dir << std::endl;
+            return 1;
+        }
+        std::cout << getCurrentTime() << " Логи пишутся в каталог " << file_dir << std::endl;
+    }
+    DashboardSink* dashboard_sink = nullptr;
+    if (dashboard) {
+        dashboard_sink = new DashboardSink();
+        // Экран нужно обновлять и без событий, поэтому recv ждет не дольше секунды
+        struct timeval timeout = {1, 0};
+        setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    LineSink& output = file_sink ? static_cast<LineSink&>(*file_sink)
+                     : dashboard_sink ? static_cast<LineSink&>(*dashboard_sink) : console;
 
     while (break_flag) {
-        int n = recv(socket_fd, buffer, sizeof(buffer), 0);
+        // Пока данные идут без пауз, копим вывод; write делаем, только когда сокет опустел
+        int n = recv(socket_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            output.flush();
+            n = recv(socket_fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                continue;
+            }
+        }
         if (n <= 0) {
+            output.flush();
             std::cerr << getCurrentTime() << " Соединение закрыто" << std::endl;
             break;
         }
-        
-        message_buffer.append(buffer, n);
-        
-        // Пытаемся разделить по \n если они есть
-        size_t pos = 0;
+
+        // Поиск \n через memchr (в glibc он векторизован), строки копируются в буфер вывода без промежуточных string
+        const char* begin = buffer;
+        const char* end = buffer + n;
+        const char* stamp = timestamp.get();
+        time_t now = timestamp.second();
         bool found_newline = false;
-        while ((pos = message_buffer.find('\n')) != std::string::npos) {
+        while (const char* newline = static_cast<const char*>(memchr(begin, '\n', end - begin))) {
             found_newline = true;
-            std::string message = message_buffer.substr(0, pos);
-            std::cout << getCurrentTime() << " " << message << std::endl;
-            message_buffer.erase(0, pos + 1);
+            output.append(stamp, timestamp.size());
+            if (!message_buffer.empty()) {
+                output.append(message_buffer.data(), message_buffer.size());
+                message_buffer.clear();
+            }
+            output.append(begin, newline - begin + 1);
+            output.end_line(now);
+            begin = newline + 1;
         }
-        
+        message_buffer.append(begin, end - begin);
+
         // Если нет символов новой строки или остались данные, выводим их
         if (!found_newline && !message_buffer.empty()) {
-            std::cout << getCurrentTime() << " " << message_buffer << std::endl;
+            output.append(stamp, timestamp.size());
+            output.append(message_buffer.data(), message_buffer.size());
+            output.append("\n", 1);
+            output.end_line(now);
             message_buffer.clear();
         }
     }
 
     std::cout << getCurrentTime() << " Монитор: Отключение..." << std::endl;
+    if (file_sink) {
+        file_sink->close();
+        delete file_sink;
+    }
+    delete dashboard_sink;
     close(socket_fd);
     std::cout << getCurrentTime() << " Монитор: Завершение работы выполнено." << std::endl;
     return 0;
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+// Текстовый протокол между клиентом, сервером и монитором: строка "<команда> <число> <число> ...\n".
+// Команды перечислены один раз в COMMANDS; разбор строки - одно вычисление хеша и одно сравнение,
+// сколько бы команд ни было, потому что таблица строится на этапе компиляции без коллизий.
+
+enum class Command : uint8_t {
+    UNKNOWN,
+    CLIENT,   // client [id [token acked]] - подключение или возобновление сессии
+    MONITOR,  // monitor - подключение монитора
+    START,    // start <id> <token> - ответ сервера на подключение
+    BREAK,    // break - отказ в подключении
+    CHECK,    // check <to> <from> [seq] - просьба проверить программу
+    REVIEWED, // reviewed <to> <from> <result> [seq] - заключение по программе
+    QUEUE,    // queue <id> (клиент) / queue <from> <id> (сервер, from = -1 - очередь пуста)
+    ACK,      // ack <id> <seq> - подтверждение сообщений почтового ящика
+    STATS,    // stats <id> <пишет мс> <проверяет мс> <спит мс>
+    ADMIN,    // admin - подключение канала управления
+    SET,      // set <параметр> <значение> - изменение параметра модели администратором
+    PARAM,    // param <параметр> <значение> - рассылка нового значения клиентам
+    OK,       // ok <текст> - ответ администратору
+    ERROR,    // error <текст> - ответ администратору
+    REPLICA,  // replica - подписка резервного сервера на поток репликации
+    BUSY,     // busy <исходная строка> - сообщение клиента отклонено лимитом, его можно повторить позже
+    LOAD,     // load <id> <глубина очереди> <ожидание мс> - нагрузка проверяющего id
+    DEPARTMENT, // department <номер> - отдел, к которому относится подключение (перед client)
+};
+
+struct CommandName {
+    std::string_view name;
+    Command command;
+};
+
+constexpr CommandName COMMANDS[] = {
+    {"client", Command::CLIENT},
+    {"monitor", Command::MONITOR},
+    {"start", Command::START},
+    {"break", Command::BREAK},
+    {"check", Command::CHECK},
+    {"reviewed", Command::REVIEWED},
+    {"queue", Command::QUEUE},
+    {"ack", Command::ACK},
+    {"stats", Command::STATS},
+    {"admin", Command::ADMIN},
+    {"set", Command::SET},
+    {"param", Command::PARAM},
+    {"ok", Command::OK},
+    {"error", Command::ERROR},
+    {"replica", Command::REPLICA},
+    {"busy", Command::BUSY},
+    {"load", Command::LOAD},
+    {"department", Command::DEPARTMENT},
+};
+
+constexpr size_t COMMANDS_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+constexpr std::string_view command_name(Command command) {
+    for (const CommandName& entry : COMMANDS) {
+        if (entry.command == command) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+namespace protocol_detail {
+
+constexpr size_t TABLE_SIZE = 64;
+
+constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char c : name) {
+        h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return h & (TABLE_SIZE - 1);
+}
+
+constexpr bool is_perfect(uint32_t seed) {
+    bool used[TABLE_SIZE] = {};
+    for (const CommandName& entry : COMMANDS) {
+        uint32_t slot = hash(entry.name, seed);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+// Первое зерно, при котором у команд нет коллизий. Новая команда просто меняет найденное зерно.
+constexpr uint32_t find_seed() {
+    for (uint32_t seed = 0; seed < 10000; seed++) {
+        if (is_perfect(seed)) {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t SEED = find_seed();
+static_assert(SEED != UINT32_MAX, "не найдено зерно совершенного хеша команд, увеличьте TABLE_SIZE");
+
+struct Table {
+    CommandName slots[TABLE_SIZE] = {};
+};
+
+constexpr Table build_table() {
+    Table table;
+    for (const CommandName& entry : COMMANDS) {
+        table.slots[hash(entry.name, SEED)] = entry;
+    }
+    return table;
+}
+
+constexpr Table TABLE = build_table();
+
+} // namespace protocol_detail
+
+constexpr Command lookup_command(std::string_view name) {
+    const CommandName& entry = protocol_detail::TABLE.slots[protocol_detail::hash(name, protocol_detail::SEED)];
+    return entry.name == name && !name.empty() ? entry.command : Command::UNKNOWN;
+}
+
+static_assert(lookup_command("reviewed") == Command::REVIEWED, "таблица команд построена неверно");
+static_assert(lookup_command("review") == Command::UNKNOWN, "таблица команд построена неверно");
+
+// Разобранная строка протокола. Числа хранятся как long long; значения больше LLONG_MAX
+// (токены сессии) сохраняются побитово, их читают через static_cast<unsigned long long>.
+struct ParsedMessage {
+    static const int MAX_ARGS = 5;
+    Command command = Command::UNKNOWN;
+    std::string_view name;
+    long long args[MAX_ARGS] = {0, 0, 0, 0, 0};
+    int count = 0;
+};
+
+// Разбор без выделения памяти. false, если после команды встретилось не число
+// (команды с текстовыми аргументами, например set и param, читаются через message_word).
+inline bool parse_message(std::string_view line, ParsedMessage& parsed) {
+    size_t pos = 0;
+    bool first = true;
+    while (pos < line.size()) {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\r' || line[pos] == '\n')) {
+            pos++;
+        }
+        size_t end = pos;
+        while (end < line.size() && line[end] != ' ' && line[end] != '\r' && line[end] != '\n') {
+            end++;
+        }
+        if (end == pos) {
+            break;
+        }
+        const char* begin = line.data() + pos;
+        const char* finish = line.data() + end;
+        if (first) {
+            parsed.name = line.substr(pos, end - pos);
+            parsed.command = lookup_command(parsed.name);
+            first = false;
+        } else if (parsed.count < ParsedMessage::MAX_ARGS) {
+            auto result = std::from_chars(begin, finish, parsed.args[parsed.count]);
+            if (result.ec == std::errc::result_out_of_range) {
+                unsigned long long value = 0;
+                result = std::from_chars(begin, finish, value);
+                if (result.ec != std::errc()) {
+                    return false;
+                }
+                parsed.args[parsed.count] = static_cast<long long>(value);
+            }
+            if (result.ec != std::errc() || result.ptr != finish) {
+                return false;
+            }
+            parsed.count++;
+        }
+        pos = end;
+    }
+    return true;
+}
+
+// Слово строки с номером index (0 - команда), пустое, если слов меньше
+inline std::string_view message_word(std::string_view line, int index) {
+    size_t pos = 0;
+    while (true) {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\r' || line[pos] == '\n')) {
+            pos++;
+        }
+        size_t end = pos;
+        while (end < line.size() && line[end] != ' ' && line[end] != '\r' && line[end] != '\n') {
+            end++;
+        }
+        if (end == pos || index == 0) {
+            return line.substr(pos, end - pos);
+        }
+        index--;
+        pos = end;
+    }
+}
+
+// Строка на стеке для сборки сообщений и строк лога: числа форматируются через std::to_chars,
+// поэтому сборка не выделяет память. Не поместившийся хвост отбрасывается.
+class LineBuffer {
+public:
+    static const size_t CAPACITY = 512;
+
+    LineBuffer& operator<<(std::string_view text) {
+        size_t n = std::min(text.size(), CAPACITY - length);
+        memcpy(buffer + length, text.data(), n);
+        length += n;
+        return *this;
+    }
+
+    LineBuffer& operator<<(char c) {
+        if (length < CAPACITY) {
+            buffer[length++] = c;
+        }
+        return *this;
+    }
+
+    LineBuffer& operator<<(Command command) {
+        return *this << command_name(command);
+    }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> > >
+    LineBuffer& operator<<(T value) {
+        auto result = std::to_chars(buffer + length, buffer + CAPACITY, value);
+        if (result.ec == std::errc()) {
+            length = result.ptr - buffer;
+        }
+        return *this;
+    }
+
+    std::string_view view() const { return std::string_view(buffer, length); }
+    const char* data() const { return buffer; }
+    size_t size() const { return length; }
+
+private:
+    char buffer[CAPACITY];
+    size_t length = 0;
+};
@@ -0,0 +1,366 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "trace.h"
+
+// Воспроизведение трассы сервера: три соединения с теми же ID повторяют запросы
+// check/reviewed/queue и отключения/переподключения из трассы, а ответы сервера
+// сравниваются с тем, что сервер разослал при записи трассы.
+
+const int CLIENTS_COUNT = 3;
+const int WAIT_TIMEOUT_MS = 10000; // после переподключения поток сервера может спать до 5 секунд
+const int BUSY_RETRY_MS = 200; // пауза перед повтором сообщения, отклоненного лимитом (check - 5 в секунду)
+
+struct Connection {
+    int fd = -1;
+    bool online = false;
+    unsigned long long token = 0;
+    unsigned long long max_seq = 0; // для пропуска повторов из почтового ящика
+    std::string buffer;
+    std::deque<std::string> lines;
+    std::vector<std::string> deferred; // ожидаемые сообщения, отправленные пока соединение было закрыто
+};
+
+std::string host_address;
+int port;
+Connection connections[CLIENTS_COUNT];
+int busy_retries = 0;
+
+int connect_to_server() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = inet_addr(host_address.c_str());
+    if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void send_line(Connection& conn, const std::string& line) {
+    std::string message = line + "\n";
+    send(conn.fd, message.c_str(), message.size(), 0);
+}
+
+// Дочитывает из сокета в очередь строк, ожидая данных не больше timeout_ms. false - соединение закрыто.
+bool fill(Connection& conn, int timeout_ms) {
+    struct pollfd pfd = {conn.fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return true;
+    }
+    char buffer[1024];
+    int n = recv(conn.fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        return false;
+    }
+    conn.buffer.append(buffer, n);
+    size_t pos;
+    while ((pos = conn.buffer.find('\n')) != std::string::npos) {
+        conn.lines.push_back(conn.buffer.substr(0, pos));
+        conn.buffer.erase(0, pos + 1);
+    }
+    return true;
+}
+
+// Чтение одной строки с ограничением по времени. false - таймаут или соединение закрыто.
+bool read_line(Connection& conn, std::string& line, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (conn.lines.empty()) {
+        int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0 || !fill(conn, left)) {
+            return false;
+        }
+    }
+    line = conn.lines.front();
+    conn.lines.pop_front();
+    return true;
+}
+
+// Сервер отвечает "busy <строка>" на сообщения сверх лимита частоты (при --speed max это обычное дело).
+// Такие сообщения отправляются повторно после паузы и расхождением не считаются. true, если что-то повторено.
+bool retry_busy(Connection& conn) {
+    bool retried = false;
+    for (auto it = conn.lines.begin(); it != conn.lines.end(); ) {
+        if (it->rfind("busy ", 0) != 0) {
+            ++it;
+            continue;
+        }
+        std::string original = it->substr(5);
+        it = conn.lines.erase(it);
+        std::this_thread::sleep_for(std::chrono::milliseconds(BUSY_RETRY_MS));
+        send_line(conn, original);
+        busy_retries++;
+        retried = true;
+    }
+    return retried;
+}
+
+// Разбирает check/reviewed: возвращает строку без номера сообщения и сам номер (0, если его нет)
+std::string strip_seq(const std::string& line, unsigned long long& seq) {
+    std::istringstream iss(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (iss >> token) {
+        tokens.push_back(token);
+    }
+    size_t fields = 0;
+    if (!tokens.empty() && tokens[0] == "check") {
+        fields = 3;
+    } else if (!tokens.empty() && tokens[0] == "reviewed") {
+        fields = 4;
+    }
+    seq = 0;
+    if (fields != 0 && tokens.size() > fields) {
+        seq = strtoull(tokens[fields].c_str(), NULL, 10);
+        tokens.resize(fields);
+    }
+    std::string result;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        result += (i ? " " : "") + tokens[i];
+    }
+    return result;
+}
+
+// Ожидание конкретного сообщения на соединении. Повторы из почтового ящика пропускаются,
+// все полученные сообщения сразу подтверждаются, чтобы ящик на сервере не рос.
+// sender - соединение, отправившее запрос: отказ busy приходит ему, и запрос повторяется.
+bool expect_line(int id, const std::string& expected, unsigned long long expected_seq, std::string& got, int sender = -1) {
+    Connection& conn = connections[id];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_TIMEOUT_MS);
+    while (true) {
+        bool retried = false;
+        if (sender >= 0 && sender != id && connections[sender].online) {
+            fill(connections[sender], 0);
+            retried = retry_busy(connections[sender]);
+        }
+        retried = retry_busy(conn) || retried;
+        if (retried) {
+            // Ответ на повтор может прийти не раньше, чем освободится лимит
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_TIMEOUT_MS);
+        }
+        if (conn.lines.empty()) {
+            int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            // Короткие ожидания, чтобы замечать отказы busy на соединении отправителя
+            if (left <= 0 || !fill(conn, std::min(left, 50))) {
+                got = "<нет ответа>";
+                return false;
+            }
+            continue;
+        }
+        std::string line = conn.lines.front();
+        conn.lines.pop_front();
+        // Сведения о нагрузке проверяющих зависят от времени и в трассу не пишутся
+        if (line.rfind("load ", 0) == 0) {
+            continue;
+        }
+        unsigned long long seq;
+        std::string core = strip_seq(line, seq);
+        if (seq != 0) {
+            if (seq <= conn.max_seq) {
+                continue;
+            }
+            conn.max_seq = seq;
+            send_line(conn, "ack " + std::to_string(id) + " " + std::to_string(seq));
+        }
+        got = line;
+        return core == expected && (seq == 0 || expected_seq == 0 || seq == expected_seq);
+    }
+}
+
+bool start_connection(int id, const std::string& hello) {
+    Connection& conn = connections[id];
+    conn.fd = connect_to_server();
+    if (conn.fd < 0) {
+        return false;
+    }
+    conn.buffer.clear();
+    conn.lines.clear();
+    send_line(conn, hello);
+    return true;
+}
+
+bool read_start(int id, int& assigned_id) {
+    Connection& conn = connections[id];
+    std::string line;
+    if (!read_line(conn, line, WAIT_TIMEOUT_MS)) {
+        return false;
+    }
+    std::istringstream iss(line);
+    std::string cmd;
+    iss >> cmd >> assigned_id >> conn.token;
+    if (cmd != "start") {
+        return false;
+    }
+    conn.online = true;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4 && argc != 6) {
+        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт> <файл трассы> [--speed N|max]" << std::endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    host_address = argv[1];
+    port = atoi(argv[2]);
+    double speed = 1.0; // 0 - максимальная скорость
+    if (argc == 6) {
+        if (strcmp(argv[4], "--speed") != 0) {
+            std::cerr << "Неизвестный параметр " << argv[4] << std::endl;
+            return 1;
+        }
+        speed = strcmp(argv[5], "max") == 0 ? 0 : atof(argv[5]);
+    }
+
+    std::vector<TraceRecord> records;
+    if (!read_trace(argv[3], records) || records.empty()) {
+        std::cerr << "Не удалось прочитать трассу " << argv[3] << std::endl;
+        return 1;
+    }
+    std::cout << "Прочитано событий: " << records.size() << std::endl;
+
+    // Сервер выдает ID по порядку подключения, поэтому подключаемся все сразу и проверяем выданные ID
+    Connection ordered[CLIENTS_COUNT];
+    for (int i = 0; i < CLIENTS_COUNT; i++) {
+        if (!start_connection(i, "client")) {
+            std::cerr << "Ошибка подключения к серверу" << std::endl;
+            return 1;
+        }
+    }
+    for (int i = 0; i < CLIENTS_COUNT; i++) {
+        int assigned_id;
+        if (!read_start(i, assigned_id) || assigned_id < 0 || assigned_id >= CLIENTS_COUNT) {
+            std::cerr << "Сервер не выдал ID соединению #" << i << std::endl;
+            return 1;
+        }
+        ordered[assigned_id] = connections[i];
+    }
+    for (int i = 0; i < CLIENTS_COUNT; i++) {
+        connections[i] = ordered[i];
+    }
+    std::cout << "Подключено " << CLIENTS_COUNT << " клиента, начинаю воспроизведение"
+              << (speed == 0 ? " с максимальной скоростью" : " со скоростью x" + std::to_string(speed)) << std::endl;
+
+    int sent = 0, matched = 0, mismatched = 0;
+    int initial_connects = 0;
+    auto replay_start = std::chrono::steady_clock::now();
+    uint64_t trace_start = records.front().timestamp_ns;
+
+    for (const TraceRecord& rec : records) {
+        if (speed > 0) {
+            auto offset = std::chrono::nanoseconds(static_cast<long long>((rec.timestamp_ns - trace_start) / speed));
+            std::this_thread::sleep_until(replay_start + offset);
+        }
+
+        std::string expected;
+        int target = -1;
+        int sender = -1;
+        if (rec.type == TRACE_CONNECT) {
+            // Первые подключения уже выполнены выше
+            if (initial_connects < CLIENTS_COUNT) {
+                initial_connects++;
+                continue;
+            }
+            Connection& conn = connections[rec.from_id];
+            std::string hello = "client " + std::to_string(rec.from_id) + " " + std::to_string(conn.token)
+                              + " " + std::to_string(conn.max_seq);
+            // Сервер замечает отключение не сразу, поэтому повторяем попытку, пока не получим start
+            bool started = false;
+            for (int attempt = 0; attempt < 25 && !started; attempt++) {
+                int assigned_id;
+                started = start_connection(rec.from_id, hello) && read_start(rec.from_id, assigned_id);
+                if (!started) {
+                    close(conn.fd);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                }
+            }
+            if (!started) {
+                std::cout << "Не удалось переподключить ID:" << (int)rec.from_id << std::endl;
+                mismatched++;
+                continue;
+            }
+            std::vector<std::string> deferred;
+            deferred.swap(conn.deferred);
+            for (const std::string& line : deferred) {
+                std::string got;
+                if (expect_line(rec.from_id, line, 0, got)) {
+                    matched++;
+                } else {
+                    mismatched++;
+                    std::cout << "Расхождение после переподключения ID:" << (int)rec.from_id << ": ожидалось \""
+                              << line << "\", получено \"" << got << "\"" << std::endl;
+                }
+            }
+            continue;
+        } else if (rec.type == TRACE_DISCONNECT) {
+            Connection& conn = connections[rec.from_id];
+            if (conn.online) {
+                close(conn.fd);
+                conn.online = false;
+            }
+            continue;
+        } else if (rec.type == TRACE_CHECK) {
+            send_line(connections[rec.from_id], "check " + std::to_string(rec.to_id) + " " + std::to_string(rec.from_id));
+            expected = "check " + std::to_string(rec.to_id) + " " + std::to_string(rec.from_id);
+            target = rec.to_id;
+            sender = rec.from_id;
+        } else if (rec.type == TRACE_REVIEWED) {
+            send_line(connections[rec.from_id], "reviewed " + std::to_string(rec.to_id) + " " + std::to_string(rec.from_id)
+                      + " " + std::to_string(rec.result));
+            expected = "reviewed " + std::to_string(rec.to_id) + " " + std::to_string(rec.from_id) + " " + std::to_string(rec.result);
+            target = rec.to_id;
+            sender = rec.from_id;
+        } else if (rec.type == TRACE_QUEUE_REPLY) {
+            send_line(connections[rec.to_id], "queue " + std::to_string(rec.to_id));
+            expected = "queue " + std::to_string(rec.from_id) + " " + std::to_string(rec.to_id);
+            target = rec.to_id;
+            sender = rec.to_id;
+        } else {
+            continue;
+        }
+        sent++;
+
+        if (!connections[target].online) {
+            connections[target].deferred.push_back(expected);
+            continue;
+        }
+        std::string got;
+        if (expect_line(target, expected, rec.seq, got, sender)) {
+            matched++;
+        } else {
+            mismatched++;
+            std::cout << "Расхождение для ID:" << target << ": ожидалось \"" << expected
+                      << (rec.seq ? " " + std::to_string(rec.seq) : "") << "\", получено \"" << got << "\"" << std::endl;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+    double trace_seconds = (records.back().timestamp_ns - trace_start) / 1e9;
+    std::cout << "Воспроизведение завершено за " << seconds << " с (в трассе " << trace_seconds << " с)" << std::endl;
+    std::cout << "Отправлено запросов: " << sent << ", совпало ответов: " << matched
+              << ", расхождений: " << mismatched << ", повторов после busy: " << busy_retries << std::endl;
+
+    for (auto& conn : connections) {
+        if (conn.online) {
+            close(conn.fd);
+        }
+    }
+    return mismatched == 0 ? 0 : 1;
+}
@@ -7,89 +7,2142 @@
 #include <arpa/inet.h>
 #include <thread>
 #include <sstream>
-#include <map>
 #include <atomic>
 #include <string>
 #include <iomanip>
 #include <mutex>
 #include <cstring>
 #include <vector>
+#include <deque>
+#include <random>
+#include <cmath>
 #include <fcntl.h>
+#include <sys/un.h>
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <string_view>
+#include "protocol.h"
+#include "sim_random.h"
+#include "trace.h"
 
 int break_flag = 1;
 std::vector<int> monitor_socket_fds;
 std::mutex monitor_socket_mutex;
-std::mutex clients_mutex; // для работы с мапой clients
+std::mutex mailbox_mutex; // для работы с почтовыми ящиками клиентов
+TraceWriter trace_writer; // бинарная трасса событий (режим --trace)
+std::mutex params_mutex; // параметры модели, измененные администратором
+std::vector<std::pair<std::string, std::string> > param_overrides; // в порядке изменения, по одному на параметр
+
+// Горячий перезапуск (режим --handoff): на время передачи состояния новому процессу
+// потоки маршрутизации, наблюдателя и приема подключений останавливаются на границе сообщений.
+const int HANDOFF_THREADS = 5; // три потока клиентов, наблюдатель и прием подключений
+std::atomic<bool> handoff_pause(false);
+std::atomic<int> paused_threads(0);
+std::mutex pause_owner_mutex; // остановку потоков в один момент проводит только одна процедура
+std::mutex handoff_mutex;
+std::vector<std::string> handoff_buffers(3); // недочитанные части строк клиентов
+
+// Администраторов и подписку реплик обслуживают отдельные потоки, и каждому нужна ячейка эпохи
+// в реестре клиентов, поэтому таких потоков одновременно не больше MAX_SERVICE_CONNECTIONS
+const int SERVER_THREADS = 8; // основной, три потока клиентов, наблюдатель, прием подключений, передача состояния и запас
+const int MAX_SERVICE_CONNECTIONS = 32;
+std::atomic<int> service_connections(0);
 
 // Класс чтобы логировать в консоль и в сокет монитора
 class Logger {
 public:
-    static void log(const std::string& message) {
+    static void log(std::string_view message) {
         std::cout << message << std::endl;
-        std::string log_message = message + '\n';
+        // Строка с переводом строки собирается на стеке; длинные строки уходят двумя send
+        char line[1024];
+        bool fits = message.size() < sizeof(line);
+        if (fits) {
+            memcpy(line, message.data(), message.size());
+            line[message.size()] = '\n';
+        }
         std::lock_guard<std::mutex> lock(monitor_socket_mutex);
         for (auto it = monitor_socket_fds.begin(); it != monitor_socket_fds.end(); ) {
             int fd = *it;
-            if (send(fd, log_message.c_str(), log_message.length(), 0) < 0) {
+            ssize_t sent = fits ? send(fd, line, message.size() + 1, 0)
+                                : (send(fd, message.data(), message.size(), 0) < 0 ? -1 : send(fd, "\n", 1, 0));
+            if (sent < 0) {
                 std::cerr << "Ошибка отправки лога в монитор (socket " << fd << "): " << strerror(errno) << std::endl;
                 close(fd);
                 it = monitor_socket_fds.erase(it);
             } else {
-                ++it;
+                ++it;
+            }
+        }
+    }
+
+    static void log(const LineBuffer& line) {
+        log(line.view());
+    }
+};
+
+// Занимает место для потока администратора или реплики; при превышении лимита соединение закрывается.
+// Место освобождает поток соединения при завершении.
+bool admit_service_connection(int socket_fd) {
+    if (service_connections.fetch_add(1) >= MAX_SERVICE_CONNECTIONS) {
+        service_connections--;
+        LineBuffer line;
+        line << "[ЛИМИТЫ] Заняты все " << MAX_SERVICE_CONNECTIONS << " потоков администраторов и реплик, соединение (сокет "
+             << socket_fd << ") отклонено";
+        Logger::log(line);
+        close(socket_fd);
+        return false;
+    }
+    return true;
+}
+
+// Поток репликации для резервного сервера (режим --standby). Каждое изменение состояния (почтовые ящики,
+// очереди задач, параметры, учет состояний) отправляется подписанным репликам строкой в том же формате,
+// что и снимок состояния при горячем перезапуске. publish вызывается под мьютексом изменяемой структуры,
+// поэтому порядок строк совпадает с порядком изменений.
+class Replicator {
+public:
+    bool active() const {
+        return has_replicas;
+    }
+
+    void add(int replica_fd) {
+        // Медленная реплика не должна надолго задерживать маршрутизацию
+        struct timeval timeout = {1, 0};
+        setsockopt(replica_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        std::lock_guard<std::mutex> lock(mutex);
+        replica_fds.push_back(replica_fd);
+        has_replicas = true;
+    }
+
+    void publish(const LineBuffer& line) {
+        if (!has_replicas) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = replica_fds.begin(); it != replica_fds.end(); ) {
+            if (send(*it, line.data(), line.size(), 0) != (ssize_t)line.size()) {
+                // Реплика переподключится и получит новый снимок
+                LineBuffer log_line;
+                log_line << "Реплика (сокет " << *it << ") отстала или отключилась, отключаю ее";
+                Logger::log(log_line);
+                close(*it);
+                it = replica_fds.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        has_replicas = !replica_fds.empty();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<int> replica_fds;
+    std::atomic<bool> has_replicas{false};
+};
+
+Replicator replicator;
+
+// Реестр подключений клиентов: плотный массив по ID, в ячейке - атомарно опубликованный указатель
+// на подключение. Поиск сокета - одно чтение без блокировок. Подключение, снятое с публикации,
+// освобождается (и его сокет закрывается) только когда все потоки, которые могли его прочитать,
+// вышли из секции чтения (эпохи), поэтому номер закрытого сокета не может достаться чужому send.
+class ClientRegistry {
+public:
+    static const int SIZE = 3;
+
+    struct Connection {
+        int fd;
+    };
+
+    // Секция чтения: пока она открыта, прочитанные сокеты не закрываются.
+    // Вложенные секции допустимы; перед долгим ожиданием секцию нужно закрыть через leave().
+    class Guard {
+    public:
+        explicit Guard(ClientRegistry& registry) : registry(registry) {
+            registry.enter();
+        }
+        ~Guard() {
+            leave();
+        }
+        void leave() {
+            if (active) {
+                active = false;
+                registry.exit();
+            }
+        }
+
+    private:
+        ClientRegistry& registry;
+        bool active = true;
+    };
+
+    ClientRegistry() {
+        for (auto& slot : slots) {
+            slot.store(nullptr);
+        }
+        for (auto& epoch : thread_epochs) {
+            epoch.store(0);
+        }
+        for (auto& used : thread_slot_used) {
+            used.store(false);
+        }
+    }
+
+    static bool valid_id(int id) {
+        return id >= 0 && id < SIZE;
+    }
+
+    // Сокет клиента или -1
+    int fd(int id) const {
+        const Connection* connection = slots[id].load(std::memory_order_acquire);
+        return connection ? connection->fd : -1;
+    }
+
+    // Публикует новый сокет клиента; прежнее подключение закрывается, когда его перестанут читать
+    void publish(int id, int socket_fd) {
+        Connection* connection = socket_fd == -1 ? nullptr : new Connection{socket_fd};
+        retire(slots[id].exchange(connection, std::memory_order_acq_rel));
+    }
+
+    // Клиент отключился: сокет закроется после выхода читателей. Если клиент уже успел
+    // переподключиться с другим сокетом, новое подключение не трогается.
+    void disconnect(int id, int socket_fd) {
+        Connection* connection = slots[id].load(std::memory_order_acquire);
+        if (connection && connection->fd == socket_fd
+            && slots[id].compare_exchange_strong(connection, nullptr, std::memory_order_acq_rel)) {
+            retire(connection);
+        }
+    }
+
+    // Освобождение подключений, которые уже никто не читает; вызывается и периодически наблюдателем
+    void reclaim() {
+        std::lock_guard<std::mutex> lock(retired_mutex);
+        reclaim_locked();
+    }
+
+private:
+    static const int MAX_THREADS = SERVER_THREADS + MAX_SERVICE_CONNECTIONS;
+
+    // Номер ячейки эпохи текущего потока; освобождается при завершении потока
+    struct ThreadSlot {
+        ClientRegistry* registry = nullptr;
+        int index = -1;
+        int depth = 0;
+        ~ThreadSlot() {
+            if (registry) {
+                registry->thread_slot_used[index].store(false);
+            }
+        }
+    };
+
+    ThreadSlot& thread_slot() {
+        thread_local ThreadSlot slot;
+        if (slot.registry == nullptr) {
+            for (int i = 0; i < MAX_THREADS && slot.registry == nullptr; i++) {
+                bool expected = false;
+                if (thread_slot_used[i].compare_exchange_strong(expected, true)) {
+                    slot.registry = this;
+                    slot.index = i;
+                }
+            }
+            // Потоков соединений не больше лимита, поэтому сюда можно попасть только из-за ошибки в подсчете потоков
+            if (slot.registry == nullptr) {
+                LineBuffer line;
+                line << "[ОШИБКА] Все " << MAX_THREADS << " ячеек эпох реестра клиентов заняты, сервер остановлен";
+                Logger::log(line);
+                abort();
+            }
+        }
+        return slot;
+    }
+
+    void enter() {
+        ThreadSlot& slot = thread_slot();
+        if (slot.depth++ == 0) {
+            thread_epochs[slot.index].store(global_epoch.load());
+        }
+    }
+
+    void exit() {
+        ThreadSlot& slot = thread_slot();
+        if (--slot.depth == 0) {
+            thread_epochs[slot.index].store(0);
+        }
+    }
+
+    void retire(Connection* connection) {
+        if (connection == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(retired_mutex);
+        // Поток, вошедший в секцию после этого увеличения, уже видит новое значение ячейки
+        retired.push_back({connection, global_epoch.fetch_add(1)});
+        reclaim_locked();
+    }
+
+    void reclaim_locked() {
+        uint64_t min_active = UINT64_MAX;
+        for (const auto& epoch : thread_epochs) {
+            uint64_t value = epoch.load();
+            if (value != 0) {
+                min_active = std::min(min_active, value);
+            }
+        }
+        for (auto it = retired.begin(); it != retired.end(); ) {
+            if (it->second < min_active) {
+                close(it->first->fd);
+                delete it->first;
+                it = retired.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::atomic<Connection*> slots[SIZE];
+    std::atomic<uint64_t> global_epoch{1};
+    std::atomic<uint64_t> thread_epochs[MAX_THREADS]; // 0 - поток вне секции чтения
+    std::atomic<bool> thread_slot_used[MAX_THREADS];
+    std::mutex retired_mutex;
+    std::vector<std::pair<Connection*, uint64_t> > retired;
+};
+
+// Класс задачи в очереди проверяющего: исправленная после отказа программа или новая
+enum TaskKind {
+    TASK_NEW,
+    TASK_REWORK,
+    TASK_KINDS
+};
+
+struct Task {
+    int from_id;
+    int to_id;
+    int result;
+    TaskKind kind;
+    std::chrono::steady_clock::time_point queued;
+};
+
+// Порядок выдачи задач проверяющему (--queue-policy): fifo - по времени постановки,
+// priority - сначала задачи старше aging_seconds, затем исправления, затем новые программы
+enum QueuePolicy {
+    QUEUE_FIFO,
+    QUEUE_PRIORITY
+};
+
+QueuePolicy queue_policy = QUEUE_PRIORITY;
+double aging_seconds = 30; // после этого новая программа обгоняет исправления (--aging)
+double submitter_weights[3] = {1, 1, 1}; // доли авторов при разделении проверяющего (--weights)
+
+// Очереди задач на проверку. Задачи лежат в пуле фиксированного размера, у каждого ID по списку индексов
+// внутри пула на каждую пару (класс задачи, автор), поэтому постановка и выдача задачи не выделяют память.
+// Внутри класса авторы обслуживаются по кругу с дефицитом (DRR): за круг автор получает
+// submitter_weights[автор] задач, поэтому серия запросов одного автора не отодвигает остальных.
+class TaskPool {
+public:
+    static const int CAPACITY = 1024;
+
+    explicit TaskPool(int queues)
+        : queues(queues), heads(queues * TASK_KINDS * queues, -1), tails(queues * TASK_KINDS * queues, -1),
+          deficits(queues * TASK_KINDS * queues, 0), turns(queues * TASK_KINDS, 0), depths(queues, 0) {
+        for (int i = 0; i < CAPACITY; i++) {
+            next[i] = i + 1 < CAPACITY ? i + 1 : -1;
+        }
+    }
+
+    // false, если пул заполнен
+    bool push(int queue, const Task& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free_head == -1) {
+            return false;
+        }
+        int slot = free_head;
+        free_head = next[slot];
+        slots[slot] = task;
+        next[slot] = -1;
+        int list = list_index(queue, task.kind, task.from_id);
+        if (tails[list] == -1) {
+            heads[list] = slot;
+        } else {
+            next[tails[list]] = slot;
+        }
+        tails[list] = slot;
+        used++;
+        depths[queue]++;
+        if (replicator.active()) {
+            LineBuffer line;
+            line << "task " << queue << ' ' << task.from_id << ' ' << task.result << ' ' << static_cast<int>(task.kind) << '\n';
+            replicator.publish(line);
+        }
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < CAPACITY; i++) {
+            next[i] = i + 1 < CAPACITY ? i + 1 : -1;
+        }
+        free_head = 0;
+        used = 0;
+        std::fill(depths.begin(), depths.end(), 0);
+        std::fill(heads.begin(), heads.end(), -1);
+        std::fill(tails.begin(), tails.end(), -1);
+        std::fill(deficits.begin(), deficits.end(), 0);
+        std::fill(turns.begin(), turns.end(), 0);
+    }
+
+    // Задачи очереди в порядке постановки, для передачи состояния при горячем перезапуске
+    std::vector<Task> snapshot(int queue) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Task> result;
+        for (int kind = 0; kind < TASK_KINDS; kind++) {
+            for (int from = 0; from < queues; from++) {
+                for (int slot = heads[list_index(queue, kind, from)]; slot != -1; slot = next[slot]) {
+                    result.push_back(slots[slot]);
+                }
+            }
+        }
+        std::stable_sort(result.begin(), result.end(), [](const Task& a, const Task& b) { return a.queued < b.queued; });
+        return result;
+    }
+
+    // Забирает следующую задачу очереди по queue_policy; false, если очередь пуста.
+    // aged - задача выдана вне очереди классов, потому что ждала дольше aging_seconds.
+    bool pop(int queue, Task& task, bool* aged = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Самая старая задача: для fifo и для старения
+        int oldest = -1;
+        bool has_kind[TASK_KINDS] = {};
+        for (int kind = 0; kind < TASK_KINDS; kind++) {
+            for (int from = 0; from < queues; from++) {
+                int slot = heads[list_index(queue, kind, from)];
+                if (slot == -1) {
+                    continue;
+                }
+                has_kind[kind] = true;
+                if (oldest == -1 || slots[slot].queued < slots[oldest].queued) {
+                    oldest = slot;
+                }
+            }
+        }
+        if (oldest == -1) {
+            return false;
+        }
+        bool is_aged = false;
+        if (queue_policy == QUEUE_PRIORITY) {
+            auto waited = std::chrono::steady_clock::now() - slots[oldest].queued;
+            is_aged = waited >= std::chrono::duration<double>(aging_seconds);
+        }
+        if (aged) {
+            *aged = is_aged && slots[oldest].kind != TASK_REWORK;
+        }
+        bool popped;
+        if (queue_policy == QUEUE_FIFO || is_aged) {
+            popped = pop_locked(queue, slots[oldest].kind, slots[oldest].from_id, task);
+        } else {
+            int kind = has_kind[TASK_REWORK] ? TASK_REWORK : TASK_NEW;
+            popped = pop_locked(queue, kind, next_submitter(queue, kind), task);
+        }
+        // Выбор автора зависит от хода и дефицитов DRR, поэтому реплика получает их после каждой выдачи
+        if (replicator.active()) {
+            LineBuffer line;
+            describe_drr_locked(queue, line);
+            replicator.publish(line);
+        }
+        return popped;
+    }
+
+    // Строка снимка: "drr <ID> <ход по классам> <дефициты списков (класс, автор) в миллионных>".
+    // Без нее преемник начал бы круг DRR заново и выдавал задачи в другом порядке.
+    void describe_drr(int queue, LineBuffer& line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        describe_drr_locked(queue, line);
+    }
+
+    // turns - TASK_KINDS значений, deficits - TASK_KINDS * queues значений в миллионных
+    bool restore_drr(int queue, const int* restored_turns, const long long* restored_deficits) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int kind = 0; kind < TASK_KINDS; kind++) {
+            if (restored_turns[kind] < 0 || restored_turns[kind] >= queues) {
+                return false;
+            }
+        }
+        for (int kind = 0; kind < TASK_KINDS; kind++) {
+            turns[queue * TASK_KINDS + kind] = restored_turns[kind];
+            for (int from = 0; from < queues; from++) {
+                deficits[list_index(queue, kind, from)] = restored_deficits[kind * queues + from] / 1e6;
+            }
+        }
+        return true;
+    }
+
+    // Забирает первую задачу заданного класса и автора (применение строки dequeue на резервном сервере)
+    bool pop_from(int queue, int kind, int from, Task& task) {
+        if (kind < 0 || kind >= TASK_KINDS || from < 0 || from >= queues) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        return pop_locked(queue, kind, from, task);
+    }
+
+    // Число задач во всех очередях
+    int size() const {
+        return used;
+    }
+
+    // Число задач в очереди queue
+    int depth(int queue) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return depths[queue];
+    }
+
+private:
+    int list_index(int queue, int kind, int from) const {
+        return (queue * TASK_KINDS + kind) * queues + from;
+    }
+
+    void describe_drr_locked(int queue, LineBuffer& line) const {
+        line << "drr " << queue;
+        for (int kind = 0; kind < TASK_KINDS; kind++) {
+            line << ' ' << turns[queue * TASK_KINDS + kind];
+        }
+        for (int kind = 0; kind < TASK_KINDS; kind++) {
+            for (int from = 0; from < queues; from++) {
+                line << ' ' << static_cast<long long>(std::llround(deficits[list_index(queue, kind, from)] * 1e6));
+            }
+        }
+        line << '\n';
+    }
+
+    // Автор, чья очередь в классе kind обслуживается сейчас. В классе есть хотя бы одна задача,
+    // а веса положительны, поэтому цикл заканчивается.
+    int next_submitter(int queue, int kind) {
+        int& turn = turns[queue * TASK_KINDS + kind];
+        while (true) {
+            int list = list_index(queue, kind, turn);
+            if (heads[list] == -1) {
+                deficits[list] = 0;
+            } else if (deficits[list] >= 1) {
+                return turn;
+            } else {
+                deficits[list] += submitter_weights[turn];
+                if (deficits[list] >= 1) {
+                    return turn;
+                }
+            }
+            turn = (turn + 1) % queues;
+        }
+    }
+
+    bool pop_locked(int queue, int kind, int from, Task& task) {
+        int list = list_index(queue, kind, from);
+        int slot = heads[list];
+        if (slot == -1) {
+            return false;
+        }
+        // Доля автора в круге DRR израсходована или его очередь опустела - ход переходит к следующему
+        deficits[list] = std::max(0.0, deficits[list] - 1);
+        int& turn = turns[queue * TASK_KINDS + kind];
+        if (turn == from && (next[slot] == -1 || deficits[list] < 1)) {
+            if (next[slot] == -1) {
+                deficits[list] = 0;
+            }
+            turn = (turn + 1) % queues;
+        }
+        task = slots[slot];
+        heads[list] = next[slot];
+        if (heads[list] == -1) {
+            tails[list] = -1;
+        }
+        next[slot] = free_head;
+        free_head = slot;
+        used--;
+        depths[queue]--;
+        if (replicator.active()) {
+            // Класс и автор передаются явно, чтобы реплика не зависела от своих часов и состояния DRR
+            LineBuffer line;
+            line << "dequeue " << queue << ' ' << kind << ' ' << from << '\n';
+            replicator.publish(line);
+        }
+        return true;
+    }
+
+    std::mutex mutex;
+    Task slots[CAPACITY];
+    int next[CAPACITY];
+    int free_head = 0;
+    std::atomic<int> used{0};
+    int queues;
+    std::vector<int> heads; // по списку на каждую тройку (ID, класс, автор)
+    std::vector<int> tails;
+    std::vector<double> deficits; // дефицит DRR каждого списка
+    std::vector<int> turns; // чей ход в DRR для пары (ID, класс)
+    std::vector<int> depths;
+};
+
+// Кольцевой буфер: после того как емкость выросла до рабочего размера, добавление и удаление не выделяют память
+template <typename T>
+class RingBuffer {
+public:
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    T& front() { return items[head]; }
+    T& operator[](size_t index) { return items[(head + index) % items.size()]; }
+
+    void push_back(const T& item) {
+        if (count == items.size()) {
+            std::vector<T> grown(std::max<size_t>(16, items.size() * 2));
+            for (size_t i = 0; i < count; i++) {
+                grown[i] = (*this)[i];
+            }
+            items.swap(grown);
+            head = 0;
+        }
+        items[(head + count) % items.size()] = item;
+        count++;
+    }
+
+    void pop_front() {
+        head = (head + 1) % items.size();
+        count--;
+    }
+
+private:
+    std::vector<T> items;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+enum SendTaskType {
+    REQUEST_CHECK,
+    REVIEW_RESULT, 
+    GET_QUEUE
+};
+
+struct PendingMessage {
+    unsigned long long seq;
+    SendTaskType type;
+    int from_id;
+    int result;
+};
+
+// Почтовый ящик ID: сообщения check/reviewed получают порядковый номер и хранятся,
+// пока клиент не подтвердит их командой "ack <id> <seq>". Пока клиент отключен, сообщения
+// только накапливаются, а при переподключении отправляются заново.
+struct Mailbox {
+    unsigned long long token = 0;       // токен сессии, который клиент предъявляет при переподключении
+    unsigned long long next_seq = 1;
+    unsigned long long acked_seq = 0;   // все сообщения с номером не больше этого подтверждены
+    RingBuffer<PendingMessage> pending;
+};
+
+std::vector<Mailbox> mailboxes(3);
+
+// Время программиста по состояниям из условия (пишет, проверяет, спит), по отчетам "stats" клиентов.
+// Клиент присылает накопительные значения с начала своего процесса; если они уменьшились,
+// значит клиент перезапущен, и прежние значения переносятся в base.
+struct StateTimes {
+    long long base[3] = {0, 0, 0};
+    long long last[3] = {0, 0, 0};
+
+    void update(const long long reported[3]) {
+        if (reported[0] < last[0] || reported[1] < last[1] || reported[2] < last[2]) {
+            for (int i = 0; i < 3; i++) {
+                base[i] += last[i];
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            last[i] = reported[i];
+        }
+    }
+
+    // Описание собирается в LineBuffer: отчеты stats приходят на горячем пути, ostringstream здесь выделял бы память
+    void describe(LineBuffer& out) const {
+        long long t[3];
+        for (int i = 0; i < 3; i++) {
+            t[i] = base[i] + last[i];
+        }
+        long long total = t[0] + t[1] + t[2];
+        if (total <= 0) {
+            out << "нет данных";
+            return;
+        }
+        const char* names[3] = {"пишет ", ", проверяет ", ", спит "};
+        for (int i = 0; i < 3; i++) {
+            out << names[i];
+            append_tenths(out, (t[i] + 50) / 100);
+            out << " с (";
+            append_tenths(out, (1000 * t[i] + total / 2) / total);
+            out << "%)";
+        }
+        out << ", загрузка ";
+        append_tenths(out, (1000 * (t[0] + t[1]) + total / 2) / total);
+        out << '%';
+    }
+
+private:
+    // Число в десятых долях как "12.3"
+    static void append_tenths(LineBuffer& out, long long tenths) {
+        out << tenths / 10 << '.' << tenths % 10;
+    }
+};
+
+std::mutex state_times_mutex;
+std::vector<StateTimes> state_times(3);
+
+void log_state_times() {
+    std::lock_guard<std::mutex> lock(state_times_mutex);
+    for (int id = 0; id < 3; id++) {
+        LineBuffer line;
+        line << "[СОСТОЯНИЯ] ID:" << id << ": ";
+        state_times[id].describe(line);
+        Logger::log(line);
+    }
+}
+
+// Ограничение частоты сообщений: ведро пополняется со скоростью rate токенов в секунду, но не больше burst.
+struct TokenBucket {
+    double rate;
+    double burst;
+    double tokens;
+    std::chrono::steady_clock::time_point last;
+
+    TokenBucket(double rate = 0, double burst = 0)
+        : rate(rate), burst(burst), tokens(burst), last(std::chrono::steady_clock::now()) {}
+
+    bool take(std::chrono::steady_clock::time_point now) {
+        tokens = std::min(burst, tokens + std::chrono::duration<double>(now - last).count() * rate);
+        last = now;
+        if (tokens < 1) {
+            return false;
+        }
+        tokens -= 1;
+        return true;
+    }
+};
+
+struct RateLimit {
+    Command command;
+    double rate;  // сообщений в секунду
+    double burst; // сколько можно отправить подряд после паузы
+};
+
+// Честный клиент отправляет несколько сообщений в секунду, поэтому лимиты с большим запасом
+const RateLimit RATE_LIMITS[] = {
+    {Command::CHECK, 5, 10},
+    {Command::REVIEWED, 5, 10},
+    {Command::QUEUE, 20, 40},
+    {Command::ACK, 20, 40},
+    {Command::STATS, 2, 5},
+};
+const RateLimit CONNECTION_LIMIT = {Command::UNKNOWN, 50, 100}; // все сообщения соединения вместе
+const int COMMAND_SLOTS = 32; // больше любого значения Command
+int max_in_flight = 256; // сколько запросов проверки может одновременно ждать в очередях (--max-in-flight)
+
+// Отклоненные сообщения по ID и командам; отдельно - запросы проверки сверх max_in_flight
+std::atomic<long long> rejected_by_rate[3][COMMAND_SLOTS];
+std::atomic<long long> rejected_by_in_flight(0);
+
+// Лимиты одного соединения. Принадлежат потоку маршрутизации клиента, поэтому без блокировок;
+// при переподключении клиента ведра заполняются заново.
+class Admission {
+public:
+    Admission() {
+        reset();
+    }
+
+    void reset() {
+        connection = TokenBucket(CONNECTION_LIMIT.rate, CONNECTION_LIMIT.burst);
+        for (auto& bucket : by_command) {
+            bucket = TokenBucket();
+        }
+        for (const RateLimit& limit : RATE_LIMITS) {
+            by_command[static_cast<int>(limit.command)] = TokenBucket(limit.rate, limit.burst);
+        }
+    }
+
+    // false, если сообщение превышает лимит своего типа или соединения
+    bool admit(Command command) {
+        auto now = std::chrono::steady_clock::now();
+        TokenBucket& bucket = by_command[static_cast<int>(command)];
+        return (bucket.rate == 0 || bucket.take(now)) && connection.take(now);
+    }
+
+private:
+    TokenBucket connection;
+    TokenBucket by_command[COMMAND_SLOTS];
+};
+
+// Ответ "busy <исходная строка>": клиент сам решает, повторить сообщение позже или отказаться.
+// Отправка без ожидания, чтобы клиент, который засыпает сервер и не читает ответы, не останавливал поток.
+void send_busy(int socket_fd, std::string_view message) {
+    LineBuffer reply;
+    reply << Command::BUSY;
+    // Слишком длинная строка не повторяется: обрезанный ответ потерял бы перевод строки
+    if (reply.size() + message.size() + 2 <= LineBuffer::CAPACITY) {
+        reply << ' ' << message;
+    }
+    reply << '\n';
+    send(socket_fd, reply.data(), reply.size(), MSG_DONTWAIT);
+}
+
+void log_admission_stats() {
+    for (int id = 0; id < 3; id++) {
+        std::string counts;
+        for (int command = 0; command < COMMAND_SLOTS; command++) {
+            long long count = rejected_by_rate[id][command];
+            if (count > 0) {
+                counts += " " + std::string(command_name(static_cast<Command>(command))) + ":" + std::to_string(count);
+            }
+        }
+        if (!counts.empty()) {
+            Logger::log("[ЛИМИТЫ] ID:" + std::to_string(id) + " отклонено по частоте:" + counts);
+        }
+    }
+    if (rejected_by_in_flight > 0) {
+        Logger::log("[ЛИМИТЫ] Отклонено запросов проверки сверх " + std::to_string(max_in_flight)
+                    + " ожидающих: " + std::to_string(rejected_by_in_flight));
+    }
+}
+
+void send_task(int socket_fd, SendTaskType task_type, int id_to, int id_from, int result, unsigned long long seq = 0) {
+    LineBuffer message;
+    std::string_view task_type_str;
+    if (task_type == REQUEST_CHECK) {
+        message << Command::CHECK << ' ' << id_to << ' ' << id_from;
+        task_type_str = "запрос проверки";
+    } else if (task_type == REVIEW_RESULT) {
+        message << Command::REVIEWED << ' ' << id_to << ' ' << id_from << ' ' << result;
+        task_type_str = "результат проверки";
+    } else if (task_type == GET_QUEUE) {
+        message << Command::QUEUE << ' ' << id_to << ' ' << id_from;
+        task_type_str = "ответ по очереди";
+    }
+    if (seq != 0) {
+        message << ' ' << seq;
+    }
+
+    LineBuffer log_line;
+    log_line << "Сообщение клиенту (сокет " << socket_fd << "): \"" << message.view() << "\" [" << task_type_str << "]";
+    Logger::log(log_line);
+    message << '\n';
+    send(socket_fd, message.data(), message.size(), 0);
+}
+
+// Оценка времени одной проверки у каждого проверяющего (экспоненциальное среднее).
+// Замер - время от запроса до заключения, но не больше промежутка с предыдущего заключения
+// этого проверяющего: так очередь перед запросом не попадает в оценку самой проверки.
+class ReviewEstimator {
+public:
+    static constexpr double DEFAULT_REVIEW_MS = 5500; // среднее время проверки клиента по умолчанию
+    static constexpr double ALPHA = 0.2;
+
+    void submitted(int reviewer, int author) {
+        std::lock_guard<std::mutex> lock(mutex);
+        submit_times[reviewer][author] = Clock::now();
+        has_submit[reviewer][author] = true;
+        publish_locked(reviewer);
+    }
+
+    void reviewed(int reviewer, int author) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = Clock::now();
+        if (has_submit[reviewer][author]) {
+            double sample = std::chrono::duration<double, std::milli>(now - submit_times[reviewer][author]).count();
+            if (has_reviewed[reviewer]) {
+                sample = std::min(sample, std::chrono::duration<double, std::milli>(now - last_reviewed[reviewer]).count());
+            }
+            review_ms[reviewer] += ALPHA * (sample - review_ms[reviewer]);
+            has_submit[reviewer][author] = false;
+        }
+        last_reviewed[reviewer] = now;
+        has_reviewed[reviewer] = true;
+        publish_locked(reviewer);
+    }
+
+    // Ожидание новой программы, если перед ней depth задач
+    long long wait_ms(int reviewer, int depth) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<long long>(review_ms[reviewer] * depth);
+    }
+
+    // Строка снимка: "estimator <проверяющий> <оценка мс> <мс с заключения> <мс с запросов авторов 0..2>".
+    // Моменты времени передаются возрастом (-1 - не было), потому что у процессов разные steady_clock.
+    void describe(int reviewer, LineBuffer& line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        describe_locked(reviewer, line);
+    }
+
+    void restore(int reviewer, long long estimate_ms, long long reviewed_age_ms, const long long submit_age_ms[3]) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = Clock::now();
+        review_ms[reviewer] = static_cast<double>(estimate_ms);
+        has_reviewed[reviewer] = reviewed_age_ms >= 0;
+        last_reviewed[reviewer] = now - std::chrono::milliseconds(std::max(reviewed_age_ms, 0LL));
+        for (int author = 0; author < 3; author++) {
+            has_submit[reviewer][author] = submit_age_ms[author] >= 0;
+            submit_times[reviewer][author] = now - std::chrono::milliseconds(std::max(submit_age_ms[author], 0LL));
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static long long age_ms(bool has, Clock::time_point since, Clock::time_point now) {
+        return has ? std::chrono::duration_cast<std::chrono::milliseconds>(now - since).count() : -1;
+    }
+
+    void describe_locked(int reviewer, LineBuffer& line) const {
+        auto now = Clock::now();
+        line << "estimator " << reviewer << ' ' << static_cast<long long>(review_ms[reviewer]) << ' '
+             << age_ms(has_reviewed[reviewer], last_reviewed[reviewer], now);
+        for (int author = 0; author < 3; author++) {
+            line << ' ' << age_ms(has_submit[reviewer][author], submit_times[reviewer][author], now);
+        }
+        line << '\n';
+    }
+
+    void publish_locked(int reviewer) const {
+        if (replicator.active()) {
+            LineBuffer line;
+            describe_locked(reviewer, line);
+            replicator.publish(line);
+        }
+    }
+
+    std::mutex mutex;
+    Clock::time_point submit_times[3][3];
+    bool has_submit[3][3] = {};
+    Clock::time_point last_reviewed[3];
+    bool has_reviewed[3] = {};
+    double review_ms[3] = {DEFAULT_REVIEW_MS, DEFAULT_REVIEW_MS, DEFAULT_REVIEW_MS};
+};
+
+ReviewEstimator review_estimator;
+
+// Граф ожидания: автор ждет заключения от проверяющего, которому отправил программу.
+// У автора не больше одной исходящей дуги, поэтому цикл через новую дугу находится проходом
+// по дугам от нее, а не обходом всего графа. Сиротские проверки (проверяющий отключен)
+// и долгие циклы проверяет наблюдатель клиентов раз в секунду.
+class WaitForGraph {
+public:
+    struct Orphan {
+        int author;
+        int reviewer;
+    };
+
+    void submitted(int author, int reviewer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        add_edge_locked(author, reviewer);
+        publish_locked(author);
+    }
+
+    void reviewed(int reviewer, int author) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (waits_on[author] == reviewer) {
+            remove_edge_locked(author);
+            publish_locked(author);
+        }
+    }
+
+    void connection(int id, bool is_online) {
+        std::lock_guard<std::mutex> lock(mutex);
+        online[id] = is_online;
+        changed[id] = Clock::now();
+    }
+
+    // Проверка переназначена: заключение прежнего проверяющего больше не ждут
+    void reassigned(int author, int reviewer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stale_reviewer[author] = waits_on[author];
+        add_edge_locked(author, reviewer);
+        publish_locked(author);
+    }
+
+    // true, если это заключение по переназначенной проверке и его надо отбросить
+    bool stale_verdict(int reviewer, int author) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stale_reviewer[author] != reviewer || waits_on[author] == reviewer) {
+            return false;
+        }
+        stale_reviewer[author] = -1;
+        publish_locked(author);
+        return true;
+    }
+
+    // Строка снимка: "graph <автор> <кого ждет> <переназначенный проверяющий> <мс с отправки>" (-1 - нет).
+    // Подключения в снимок не входят: их отмечают заново по переданным сокетам.
+    void describe(int author, LineBuffer& line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        describe_locked(author, line);
+    }
+
+    void restore(int author, int reviewer, int stale, long long age_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (reviewer == -1) {
+            remove_edge_locked(author);
+        } else {
+            add_edge_locked(author, reviewer);
+            since[author] = Clock::now() - std::chrono::milliseconds(std::max(age_ms, 0LL));
+        }
+        stale_reviewer[author] = stale;
+    }
+
+    // Тревоги по зависшим проверкам и циклам старше stall_seconds. Возвращает сиротские проверки
+    // старше reassign_seconds (0 - не переназначать).
+    std::vector<Orphan> check(double stall_seconds, double reassign_seconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Orphan> orphans;
+        auto now = Clock::now();
+        for (int author = 0; author < 3; author++) {
+            int reviewer = waits_on[author];
+            if (reviewer == -1 || online[reviewer]) {
+                continue;
+            }
+            double stalled = std::chrono::duration<double>(now - std::max(changed[reviewer], since[author])).count();
+            if (stalled >= stall_seconds && !alerted[author]) {
+                alerted[author] = true;
+                Logger::log("[ТРЕВОГА] Проверка программы ID:" + std::to_string(author) + " зависла: проверяющий ID:"
+                            + std::to_string(reviewer) + " отключен " + std::to_string(static_cast<int>(stalled)) + " с");
+            }
+            if (reassign_seconds > 0 && stalled >= reassign_seconds) {
+                orphans.push_back({author, reviewer});
+            }
+        }
+        if (cycle_mask != 0 && !cycle_alerted
+            && std::chrono::duration<double>(now - cycle_since).count() >= stall_seconds) {
+            cycle_alerted = true;
+            LineBuffer line;
+            line << "[ТРЕВОГА] Цикл ожидания держится " << static_cast<int>(stall_seconds) << " с: ";
+            describe_cycle_locked(line);
+            Logger::log(line);
+        }
+        return orphans;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void add_edge_locked(int author, int reviewer) {
+        waits_on[author] = reviewer;
+        since[author] = Clock::now();
+        alerted[author] = false;
+        // Цикл может пройти только через новую дугу
+        int mask = 1 << author;
+        for (int node = reviewer, steps = 0; node != -1 && steps < 3; node = waits_on[node], steps++) {
+            if (node == author) {
+                cycle_mask = mask;
+                cycle_since = Clock::now();
+                cycle_alerted = false;
+                LineBuffer line;
+                line << "[ГРАФ ОЖИДАНИЯ] Образовался цикл: ";
+                describe_cycle_locked(line);
+                Logger::log(line);
+                return;
+            }
+            mask |= 1 << node;
+        }
+    }
+
+    void remove_edge_locked(int author) {
+        waits_on[author] = -1;
+        if (cycle_mask & (1 << author)) {
+            cycle_mask = 0;
+        }
+    }
+
+    void describe_locked(int author, LineBuffer& line) const {
+        long long age = waits_on[author] == -1
+            ? -1 : std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since[author]).count();
+        line << "graph " << author << ' ' << waits_on[author] << ' ' << stale_reviewer[author] << ' ' << age << '\n';
+    }
+
+    void publish_locked(int author) const {
+        if (replicator.active()) {
+            LineBuffer line;
+            describe_locked(author, line);
+            replicator.publish(line);
+        }
+    }
+
+    // Цикл образуется при обычной маршрутизации check, поэтому описание собирается без выделения памяти
+    void describe_cycle_locked(LineBuffer& text) const {
+        int start = 0;
+        while (!(cycle_mask & (1 << start))) {
+            start++;
+        }
+        text << "ID:" << start;
+        for (int node = waits_on[start]; node != -1; node = waits_on[node]) {
+            text << " -> ID:" << node;
+            if (node == start) {
+                break;
+            }
+        }
+    }
+
+    std::mutex mutex;
+    int waits_on[3] = {-1, -1, -1};
+    Clock::time_point since[3];
+    bool alerted[3] = {};
+    bool online[3] = {};
+    Clock::time_point changed[3];
+    int stale_reviewer[3] = {-1, -1, -1};
+    int cycle_mask = 0; // участники последнего найденного цикла
+    Clock::time_point cycle_since;
+    bool cycle_alerted = false;
+};
+
+WaitForGraph wait_graph;
+double stall_seconds = 15; // через сколько секунд зависание считается тревогой (--stall-timeout)
+double reassign_seconds = 0; // через сколько секунд переназначать проверку отключенного проверяющего (--reassign)
+
+// Проверяющий отклонил программу автора: следующий запрос автора к нему - исправление [проверяющий][автор]
+std::atomic<bool> rework_expected[3][3];
+
+// Строка снимка: "rework <проверяющий> <признаки для авторов 0..2>"
+void describe_rework(int reviewer, LineBuffer& line) {
+    line << "rework " << reviewer;
+    for (int author = 0; author < 3; author++) {
+        line << ' ' << static_cast<int>(rework_expected[reviewer][author].load());
+    }
+    line << '\n';
+}
+
+void set_rework_expected(int reviewer, int author, bool expected) {
+    rework_expected[reviewer][author] = expected;
+    if (replicator.active()) {
+        LineBuffer line;
+        describe_rework(reviewer, line);
+        replicator.publish(line);
+    }
+}
+
+const char* task_kind_name(TaskKind kind, bool aged) {
+    if (aged) {
+        return "по возрасту";
+    }
+    return kind == TASK_REWORK ? "исправление" : "новая";
+}
+
+// Ожидание в очереди по способу выдачи: новая, исправление, по возрасту
+std::atomic<long long> queue_wait_ms[3];
+std::atomic<long long> queue_wait_count[3];
+
+// Ожидание в очереди по авторам: сумма, число и максимум
+std::atomic<long long> submitter_wait_ms[3];
+std::atomic<long long> submitter_wait_count[3];
+std::atomic<long long> submitter_wait_max_ms[3];
+
+void record_queue_wait(int wait_class, int from, long long waited_ms) {
+    queue_wait_ms[wait_class] += waited_ms;
+    queue_wait_count[wait_class]++;
+    submitter_wait_ms[from] += waited_ms;
+    submitter_wait_count[from]++;
+    long long max = submitter_wait_max_ms[from];
+    while (waited_ms > max && !submitter_wait_max_ms[from].compare_exchange_weak(max, waited_ms)) {
+    }
+}
+
+void log_queue_waits() {
+    const TaskKind kinds[3] = {TASK_NEW, TASK_REWORK, TASK_NEW};
+    for (int k = 0; k < 3; k++) {
+        long long count = queue_wait_count[k];
+        if (count > 0) {
+            Logger::log(std::string("[ОЧЕРЕДИ] Выдано задач (") + task_kind_name(kinds[k], k == 2) + "): " + std::to_string(count)
+                        + ", среднее ожидание " + std::to_string(queue_wait_ms[k] / count) + " мс");
+        }
+    }
+    for (int from = 0; from < 3; from++) {
+        long long count = submitter_wait_count[from];
+        if (count > 0) {
+            std::ostringstream weight;
+            weight << submitter_weights[from];
+            Logger::log("[ОЧЕРЕДИ] Задачи автора ID:" + std::to_string(from) + " (вес " + weight.str()
+                        + "): " + std::to_string(count) + ", среднее ожидание " + std::to_string(submitter_wait_ms[from] / count)
+                        + " мс, максимум " + std::to_string(submitter_wait_max_ms[from]) + " мс");
+        }
+    }
+}
+
+// "load <id> <глубина очереди> <ожидание мс>": нагрузка проверяющего id для отправителя программ.
+// Таких строк много, поэтому в лог они не пишутся.
+void send_load(int socket_fd, TaskPool& tasks, int reviewer) {
+    if (socket_fd == -1) {
+        return;
+    }
+    int depth = tasks.depth(reviewer);
+    LineBuffer message;
+    message << Command::LOAD << ' ' << reviewer << ' ' << depth << ' ' << review_estimator.wait_ms(reviewer, depth) << '\n';
+    send(socket_fd, message.data(), message.size(), 0);
+}
+
+// Доставка check/reviewed клиенту to через его почтовый ящик; вызывается под mailbox_mutex
+void deliver_task_locked(ClientRegistry& clients, SendTaskType task_type, int id_to, int id_from, int result) {
+    Mailbox& mailbox = mailboxes[id_to];
+    unsigned long long seq = mailbox.next_seq++;
+    trace_writer.record(task_type == REQUEST_CHECK ? TRACE_CHECK : TRACE_REVIEWED, id_from, id_to, result, seq);
+    mailbox.pending.push_back({seq, task_type, id_from, result});
+    if (replicator.active()) {
+        LineBuffer line;
+        line << "pending " << id_to << ' ' << seq << ' ' << static_cast<int>(task_type) << ' ' << id_from << ' ' << result << '\n';
+        replicator.publish(line);
+    }
+
+    int socket_fd = clients.fd(id_to);
+    if (socket_fd == -1) {
+        LineBuffer line;
+        line << "Клиент ID:" << id_to << " не подключен, сообщение #" << seq
+             << " сохранено в почтовом ящике (ожидают: " << mailbox.pending.size() << ")";
+        Logger::log(line);
+        return;
+    }
+    send_task(socket_fd, task_type, id_to, id_from, result, seq);
+}
+
+void deliver_task(ClientRegistry& clients, SendTaskType task_type, int id_to, int id_from, int result) {
+    std::lock_guard<std::mutex> lock(mailbox_mutex);
+    deliver_task_locked(clients, task_type, id_to, id_from, result);
+}
+
+// Запрос проверки: постановка в очередь и запись check в трассу идут под одним mailbox_mutex,
+// поэтому порядок check в трассе совпадает с порядком в очередях, и replay выдает задачи в том же порядке.
+// false, если пул задач заполнен (запрос все равно доставляется в почтовый ящик).
+bool submit_check(ClientRegistry& clients, TaskPool& tasks, int to, const Task& task) {
+    std::lock_guard<std::mutex> lock(mailbox_mutex);
+    bool queued = tasks.push(to, task);
+    deliver_task_locked(clients, REQUEST_CHECK, to, task.from_id, 0);
+    return queued;
+}
+
+// Подтверждение сообщений почтового ящика; вызывается под mailbox_mutex
+void acknowledge_locked(int id, unsigned long long seq) {
+    Mailbox& mailbox = mailboxes[id];
+    if (seq > mailbox.acked_seq) {
+        mailbox.acked_seq = seq;
+        if (replicator.active()) {
+            LineBuffer line;
+            line << "acked " << id << ' ' << seq << '\n';
+            replicator.publish(line);
+        }
+    }
+    while (!mailbox.pending.empty() && mailbox.pending.front().seq <= mailbox.acked_seq) {
+        mailbox.pending.pop_front();
+    }
+}
+
+void acknowledge(int id, unsigned long long seq) {
+    std::lock_guard<std::mutex> lock(mailbox_mutex);
+    acknowledge_locked(id, seq);
+}
+
+// Отправка клиенту "param <параметр> <значение>"
+void send_param(int socket_fd, const std::string& name, const std::string& value) {
+    LineBuffer message;
+    message << Command::PARAM << ' ' << name << ' ' << value << '\n';
+    send(socket_fd, message.data(), message.size(), 0);
+}
+
+// Регистрация сокета клиента за ID, отправка "start <id> <токен>", текущих параметров модели
+// и повтор неподтвержденных сообщений
+void attach_client(ClientRegistry& clients, int id, int socket_fd, unsigned long long client_acked_seq) {
+    std::lock_guard<std::mutex> lock(mailbox_mutex);
+    // Под params_mutex рассылка параметров не попадет к клиенту раньше start
+    std::unique_lock<std::mutex> params_lock(params_mutex);
+    clients.publish(id, socket_fd);
+    wait_graph.connection(id, true);
+    // recv потока клиента просыпается хотя бы раз в 200 мс, чтобы заметить остановку для горячего перезапуска
+    struct timeval timeout = {0, 200000};
+    setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    trace_writer.record(TRACE_CONNECT, id, -1, 0, 0);
+    Mailbox& mailbox = mailboxes[id];
+
+    LineBuffer message;
+    message << Command::START << ' ' << id << ' ' << mailbox.token << '\n';
+    Logger::log("Отправка ID:" + std::to_string(id) + " клиенту (сокет: " + std::to_string(socket_fd) + ")");
+    send(socket_fd, message.data(), message.size(), 0);
+    for (const auto& param : param_overrides) {
+        send_param(socket_fd, param.first, param.second);
+    }
+    params_lock.unlock();
+
+    acknowledge_locked(id, client_acked_seq);
+    if (!mailbox.pending.empty()) {
+        Logger::log("Повтор " + std::to_string(mailbox.pending.size()) + " неподтвержденных сообщений клиенту ID:"
+                  + std::to_string(id) + " начиная с #" + std::to_string(mailbox.pending.front().seq));
+    }
+    for (size_t i = 0; i < mailbox.pending.size(); i++) {
+        const PendingMessage& entry = mailbox.pending[i];
+        send_task(socket_fd, entry.type, id, entry.from_id, entry.result, entry.seq);
+    }
+}
+
+// Маршрутизация одной строки клиента client_id, уже прошедшей лимиты частоты. Вызывается потоком клиента;
+// в установившемся режиме не выделяет память (проверяется программой alloc_check.cpp).
+void route_message(ClientRegistry& clients, TaskPool& tasks, int client_id, int socket_fd,
+                   std::string_view message, const ParsedMessage& parsed) {
+    const long long* args = parsed.args;
+    // Номера клиентов приходят из сети, поэтому проверяем их до обращения к очередям и ящикам
+    auto valid_id = [](long long id) { return id >= 0 && id < 3; };
+    LineBuffer line;
+    line << "Получено сообщение от клиента ID:" << client_id << ": \"" << message << "\"";
+    Logger::log(line);
+    if (message.empty()) {
+        LineBuffer empty_line;
+        empty_line << "Получено пустое сообщение от клиента ID:" << client_id;
+        Logger::log(empty_line);
+        return;
+    }
+
+    switch (parsed.command) {
+    case Command::CHECK: {
+        if (parsed.count < 2 || !valid_id(args[0]) || !valid_id(args[1])) {
+            break;
+        }
+        int to = args[0], from = args[1];
+        LineBuffer request_line;
+        request_line << "Клиент ID:" << from << " запрашивает проверку у клиента ID:" << to;
+        Logger::log(request_line);
+        if (tasks.size() >= max_in_flight) {
+            rejected_by_in_flight++;
+            LineBuffer busy_line;
+            busy_line << "[ЛИМИТЫ] В очередях уже " << tasks.size() << " запросов проверки, запрос клиента ID:"
+                      << from << " отклонен";
+            Logger::log(busy_line);
+            send_busy(socket_fd, message);
+            return;
+        }
+        LineBuffer task_line;
+        TaskKind task_kind = TASK_NEW;
+        if (rework_expected[to][from].exchange(false)) {
+            task_kind = TASK_REWORK;
+            set_rework_expected(to, from, false);
+        }
+        if (submit_check(clients, tasks, to, Task{from, to, -1, task_kind, std::chrono::steady_clock::now()})) {
+            task_line << "Создана новая задача: от ID:" << from << " к ID:" << to << " результат:не определен"
+                      << " (" << task_kind_name(task_kind, false) << ")";
+            Logger::log(task_line);
+            LineBuffer queued_line;
+            queued_line << "Задача добавлена в очередь клиента ID:" << to;
+            Logger::log(queued_line);
+        } else {
+            task_line << "Пул задач заполнен (" << TaskPool::CAPACITY << "), задача для клиента ID:" << to
+                      << " не поставлена в очередь";
+            Logger::log(task_line);
+        }
+
+        review_estimator.submitted(to, from);
+        wait_graph.submitted(from, to);
+        // Отправитель сразу узнает, сколько ждать, и может выбрать другого проверяющего в следующий раз
+        send_load(clients.fd(from), tasks, to);
+        return;
+    }
+    case Command::REVIEWED: {
+        if (parsed.count < 3 || !valid_id(args[0]) || !valid_id(args[1])) {
+            break;
+        }
+        int to = args[0], from = args[1], result = args[2];
+        LineBuffer result_line;
+        result_line << "Клиент ID:" << from << " проверил клиента ID:" << to
+                    << " с результатом: " << (result == 1 ? "ПРИНЯТО" : "ОТКЛОНЕНО");
+        Logger::log(result_line);
+        if (wait_graph.stale_verdict(from, to)) {
+            LineBuffer stale_line;
+            stale_line << "Проверка программы ID:" << to << " была переназначена, заключение ID:" << from << " отброшено";
+            Logger::log(stale_line);
+            return;
+        }
+
+        // Состояние обновляется до доставки: получив заключение, автор может сразу прислать исправление,
+        // и его check должен застать уже обновленные граф ожидания и признак доработки
+        wait_graph.reviewed(from, to);
+        review_estimator.reviewed(from, to);
+        set_rework_expected(from, to, result == 0);
+        deliver_task(clients, REVIEW_RESULT, to, from, result);
+        return;
+    }
+    case Command::QUEUE: {
+        if (parsed.count < 1 || !valid_id(args[0])) {
+            break;
+        }
+        int id = args[0];
+        LineBuffer request_line;
+        request_line << "Клиент ID:" << id << " запрашивает задачи из очереди";
+        Logger::log(request_line);
+        // Перед ответом - нагрузка остальных проверяющих, клиент опрашивает очередь регулярно
+        for (int reviewer = 0; reviewer < 3; reviewer++) {
+            if (reviewer != id) {
+                send_load(clients.fd(id), tasks, reviewer);
+            }
+        }
+        Task task;
+        LineBuffer reply_line;
+        bool aged = false;
+        bool popped;
+        {
+            // Под тем же мьютексом, что и постановка check, чтобы трасса сохранила порядок очереди
+            std::lock_guard<std::mutex> lock(mailbox_mutex);
+            popped = tasks.pop(id, task, &aged);
+            trace_writer.record(TRACE_QUEUE_REPLY, popped ? task.from_id : -1, id, 0, 0);
+        }
+        if (!popped) {
+            reply_line << "Очередь для клиента ID:" << id << " пуста";
+            Logger::log(reply_line);
+            send_task(clients.fd(id), GET_QUEUE, -1, id, 0);
+        } else {
+            long long waited_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - task.queued).count();
+            int wait_class = aged ? 2 : task.kind == TASK_REWORK ? 1 : 0;
+            record_queue_wait(wait_class, task.from_id, waited_ms);
+            reply_line << "Отправка следующей задачи клиенту ID:" << id
+                       << " (от клиента ID:" << task.from_id << ", " << task_kind_name(task.kind, aged)
+                       << ", ждала " << waited_ms << " мс)";
+            Logger::log(reply_line);
+            send_task(clients.fd(id), GET_QUEUE, task.from_id, id, 0);
+        }
+        return;
+    }
+    case Command::ACK: {
+        if (parsed.count < 2 || !valid_id(args[0])) {
+            break;
+        }
+        int id = args[0];
+        unsigned long long seq = args[1];
+        acknowledge(id, seq);
+        LineBuffer ack_line;
+        ack_line << "Клиент ID:" << id << " подтвердил сообщения до #" << seq;
+        Logger::log(ack_line);
+        return;
+    }
+    case Command::STATS: {
+        if (parsed.count < 4 || !valid_id(args[0])) {
+            break;
+        }
+        int id = args[0];
+        LineBuffer description;
+        description << "[СОСТОЯНИЯ] ID:" << id << ": ";
+        {
+            std::lock_guard<std::mutex> lock(state_times_mutex);
+            state_times[id].update(args + 1);
+            state_times[id].describe(description);
+            if (replicator.active()) {
+                const StateTimes& times = state_times[id];
+                LineBuffer replication_line;
+                replication_line << "times " << id;
+                for (int k = 0; k < 3; k++) {
+                    replication_line << ' ' << times.base[k] << ' ' << times.last[k];
+                }
+                replicator.publish(replication_line << '\n');
+            }
+        }
+        Logger::log(description);
+        return;
+    }
+    default:
+        break;
+    }
+    // Сюда попадают неизвестные команды и команды с неверными аргументами
+    LineBuffer unknown_line;
+    unknown_line << "Неизвестное сообщение от клиента ID:" << client_id << ": \"" << message << "\"";
+    Logger::log(unknown_line);
+}
+
+// Канал управления: администратор подключается командой "admin" и отправляет "set <параметр> <значение>".
+// Значение проверяется, запоминается для клиентов, которые подключатся позже, и рассылается
+// всем подключенным клиентам командой param. Клиенты применяют его на ближайшей границе фаз.
+void serve_admin(ClientRegistry& clients, int admin_socket, std::string recv_buffer) {
+    char buffer[1024];
+    while (break_flag) {
+        size_t pos;
+        while ((pos = recv_buffer.find('\n')) != std::string::npos) {
+            std::string line = recv_buffer.substr(0, pos);
+            recv_buffer.erase(0, pos + 1);
+            if (message_word(line, 0).empty()) {
+                continue;
+            }
+            LineBuffer reply;
+            std::string name(message_word(line, 1));
+            std::string value(message_word(line, 2));
+            std::string error;
+            ModelParams check;
+            if (lookup_command(message_word(line, 0)) != Command::SET || name.empty() || value.empty()) {
+                reply << Command::ERROR << " ожидается: set <параметр> <значение>";
+            } else if (!check.set(name, value, error)) {
+                reply << Command::ERROR << ' ' << error;
+            } else {
+                int notified = 0;
+                // Пока снимается снимок состояния, параметры не меняем
+                while (handoff_pause) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                {
+                    std::lock_guard<std::mutex> params_lock(params_mutex);
+                    auto it = param_overrides.begin();
+                    while (it != param_overrides.end() && it->first != name) {
+                        ++it;
+                    }
+                    if (it != param_overrides.end()) {
+                        param_overrides.erase(it);
+                    }
+                    param_overrides.emplace_back(name, value);
+                    LineBuffer replication_line;
+                    replication_line << "param " << name << ' ' << value << '\n';
+                    replicator.publish(replication_line);
+
+                    ClientRegistry::Guard guard(clients);
+                    for (int id = 0; id < ClientRegistry::SIZE; id++) {
+                        int socket_fd = clients.fd(id);
+                        if (socket_fd != -1) {
+                            send_param(socket_fd, name, value);
+                            notified++;
+                        }
+                    }
+                }
+                Logger::log("[АДМИНИСТРАТОР] Параметр " + name + " = " + value + " разослан клиентам: " + std::to_string(notified));
+                reply << Command::OK << ' ' << name << '=' << value << " разослан клиентам: " << notified;
             }
+            reply << '\n';
+            send(admin_socket, reply.data(), reply.size(), 0);
+        }
+
+        int n = recv(admin_socket, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
         }
+        recv_buffer.append(buffer, n);
     }
-};
+    Logger::log("Администратор отключился (сокет: " + std::to_string(admin_socket) + ")");
+    close(admin_socket);
+    service_connections--;
+}
 
-struct Task {
-    int from_id;
-    int to_id;
-    int result;
-    Task(int f, int t, int r) : from_id(f), to_id(t), result(r) {
-        Logger::log("Создана новая задача: от ID:" + std::to_string(f) + " к ID:" + std::to_string(t) 
-                  + " результат:" + (r == -1 ? "не определен" : std::to_string(r)));
+// Поток останавливается, пока идет передача состояния. Если передача не удалась, работа продолжается.
+void park_for_handoff() {
+    paused_threads++;
+    while (handoff_pause) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
-};
+    paused_threads--;
+}
 
-enum SendTaskType {
-    REQUEST_CHECK,
-    REVIEW_RESULT, 
-    GET_QUEUE
-};
+// Остановка всех потоков обработки на границе сообщений; вызывается под pause_owner_mutex.
+// false, если потоки не остановились за 10 секунд (тогда они уже снова запущены).
+bool pause_all_threads() {
+    handoff_pause = true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (paused_threads < HANDOFF_THREADS && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (paused_threads < HANDOFF_THREADS) {
+        handoff_pause = false;
+        return false;
+    }
+    return true;
+}
 
-void send_task(int socket_fd, SendTaskType task_type, int id_to, int id_from, int result) {
-    std::string message = "";
-    if (task_type == REQUEST_CHECK) {
-        message = "check " + std::to_string(id_to) + " " + std::to_string(id_from);
-    } else if (task_type == REVIEW_RESULT) {
-        message = "reviewed " + std::to_string(id_to) + " " + std::to_string(id_from) + " " + std::to_string(result);
-    } else if (task_type == GET_QUEUE) {
-        message = "queue " + std::to_string(id_to) + " " + std::to_string(id_from);
+// Состояние сервера в текстовом виде. Сокеты складываются в fds, в тексте хранятся их номера в этом списке.
+std::string serialize_state(ClientRegistry& clients, TaskPool& tasks, int listen_fd, std::vector<int>& fds) {
+    std::ostringstream out;
+    fds.push_back(listen_fd);
+    out << "listen 0\n";
+    ClientRegistry::Guard guard(clients);
+    for (int id = 0; id < ClientRegistry::SIZE; id++) {
+        int index = -1;
+        int socket_fd = clients.fd(id);
+        if (socket_fd != -1) {
+            index = fds.size();
+            fds.push_back(socket_fd);
+        }
+        out << "client " << id << " " << index << "\n";
     }
-    message += "\n";
-    
-    std::string task_type_str;
-    std::string emoji;
-    switch (task_type) {
-        case REQUEST_CHECK: 
-            task_type_str = "запрос проверки"; 
-            emoji = "🔍";
-            break;
-        case REVIEW_RESULT: 
-            task_type_str = "результат проверки"; 
-            emoji = (result == 1) ? "ПРИНЯТО" : "ОТКЛОНЕНО";
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        for (int id = 0; id < 3; id++) {
+            // Недочитанная часть строки не содержит перевода строки, поэтому пишется как есть до конца строки
+            out << "buffer " << id << " " << handoff_buffers[id] << "\n";
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mailbox_mutex);
+        for (int id = 0; id < 3; id++) {
+            Mailbox& mailbox = mailboxes[id];
+            out << "mailbox " << id << " " << mailbox.token << " " << mailbox.next_seq << " " << mailbox.acked_seq << "\n";
+            for (size_t i = 0; i < mailbox.pending.size(); i++) {
+                const PendingMessage& entry = mailbox.pending[i];
+                out << "pending " << id << " " << entry.seq << " " << entry.type << " " << entry.from_id << " " << entry.result << "\n";
+            }
+        }
+    }
+    for (int id = 0; id < 3; id++) {
+        // Время постановки передается возрастом в мс: по нему работают fifo и старение
+        auto now = std::chrono::steady_clock::now();
+        for (const Task& task : tasks.snapshot(id)) {
+            out << "task " << id << " " << task.from_id << " " << task.result << " " << task.kind << " "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(now - task.queued).count() << "\n";
+        }
+        LineBuffer drr_line;
+        tasks.describe_drr(id, drr_line);
+        out << drr_line.view();
+    }
+    {
+        std::lock_guard<std::mutex> lock(params_mutex);
+        for (const auto& param : param_overrides) {
+            out << "param " << param.first << " " << param.second << "\n";
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_times_mutex);
+        for (int id = 0; id < 3; id++) {
+            const StateTimes& times = state_times[id];
+            out << "times " << id;
+            for (int k = 0; k < 3; k++) {
+                out << " " << times.base[k] << " " << times.last[k];
+            }
+            out << "\n";
+        }
+    }
+    // Граф ожидания, признаки исправлений и оценки проверок: без них преемник считал бы все
+    // отправленные программы новыми и не знал бы, кто кого ждет
+    for (int id = 0; id < 3; id++) {
+        LineBuffer graph_line, rework_line, estimator_line;
+        wait_graph.describe(id, graph_line);
+        describe_rework(id, rework_line);
+        review_estimator.describe(id, estimator_line);
+        out << graph_line.view() << rework_line.view() << estimator_line.view();
+    }
+    {
+        std::lock_guard<std::mutex> lock(monitor_socket_mutex);
+        for (int fd : monitor_socket_fds) {
+            out << "monitor " << fds.size() << "\n";
+            fds.push_back(fd);
+        }
+    }
+    return out.str();
+}
+
+// Применение одной строки снимка или потока репликации. fds - сокеты, переданные при горячем перезапуске
+// (у реплики их нет, и все клиенты считаются отключенными); recv_buffers - куда положить недочитанные строки.
+bool apply_state_line(const std::string& line, const std::vector<int>& fds, ClientRegistry& clients,
+                      TaskPool& tasks, int& listen_fd, std::vector<std::string>* recv_buffers) {
+    std::istringstream iss(line);
+    std::string kind;
+    iss >> kind;
+    auto fd_at = [&fds](int index) { return index >= 0 && index < (int)fds.size() ? fds[index] : -1; };
+    if (kind == "listen") {
+        int index;
+        iss >> index;
+        listen_fd = fd_at(index);
+    } else if (kind == "client") {
+        int id, index;
+        iss >> id >> index;
+        if (!ClientRegistry::valid_id(id)) {
+            return false;
+        }
+        clients.publish(id, fd_at(index));
+        // Отсчет отключения начинается заново: у реплики сокетов нет, и клиенты еще переподключатся
+        wait_graph.connection(id, fd_at(index) != -1);
+    } else if (kind == "buffer") {
+        int id;
+        iss >> id;
+        size_t start = line.find(' ', line.find(' ') + 1);
+        if (recv_buffers && id >= 0 && id < 3 && start != std::string::npos) {
+            (*recv_buffers)[id] = line.substr(start + 1);
+        }
+        return true;
+    } else if (kind == "mailbox") {
+        int id;
+        unsigned long long token, next_seq, acked_seq;
+        iss >> id >> token >> next_seq >> acked_seq;
+        if (iss && !ClientRegistry::valid_id(id)) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (iss) {
+            Mailbox& mailbox = mailboxes[id];
+            mailbox.token = token;
+            mailbox.next_seq = next_seq;
+            mailbox.acked_seq = acked_seq;
+        }
+    } else if (kind == "pending") {
+        int id, type;
+        PendingMessage entry;
+        iss >> id >> entry.seq >> type >> entry.from_id >> entry.result;
+        if (iss && (!ClientRegistry::valid_id(id) || !ClientRegistry::valid_id(entry.from_id)
+                    || (type != REQUEST_CHECK && type != REVIEW_RESULT))) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (iss) {
+            entry.type = static_cast<SendTaskType>(type);
+            Mailbox& mailbox = mailboxes[id];
+            mailbox.pending.push_back(entry);
+            mailbox.next_seq = std::max(mailbox.next_seq, entry.seq + 1);
+        }
+    } else if (kind == "acked") {
+        int id;
+        unsigned long long seq;
+        iss >> id >> seq;
+        if (iss && !ClientRegistry::valid_id(id)) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (iss) {
+            acknowledge_locked(id, seq);
+        }
+    } else if (kind == "task") {
+        int id;
+        int task_kind = TASK_NEW;
+        long long age_ms = 0;
+        Task task;
+        iss >> id >> task.from_id >> task.result;
+        if (iss && (!ClientRegistry::valid_id(id) || !ClientRegistry::valid_id(task.from_id))) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (!iss) {
+            // Строка отбрасывается, разбор необязательных полей ниже не должен сбросить ошибку
+        } else if (!(iss >> task_kind) || task_kind < 0 || task_kind >= TASK_KINDS) {
+            task_kind = TASK_NEW;
+            iss.clear();
+        } else if (!(iss >> age_ms) || age_ms < 0) {
+            // В потоке репликации возраста нет: задача только что поставлена
+            age_ms = 0;
+            iss.clear();
+        }
+        if (iss) {
+            task.to_id = id;
+            task.kind = static_cast<TaskKind>(task_kind);
+            task.queued = std::chrono::steady_clock::now() - std::chrono::milliseconds(age_ms);
+            tasks.push(id, task);
+        }
+    } else if (kind == "dequeue") {
+        int id;
+        int task_kind, from;
+        Task task;
+        iss >> id;
+        if (iss && !ClientRegistry::valid_id(id)) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (!iss) {
+            // неверный ID: строка отбрасывается
+        } else if (iss >> task_kind >> from) {
+            tasks.pop_from(id, task_kind, from, task);
+        } else {
+            iss.clear();
+            tasks.pop(id, task);
+        }
+    } else if (kind == "param") {
+        std::string name, value;
+        iss >> name >> value;
+        auto it = param_overrides.begin();
+        while (it != param_overrides.end() && it->first != name) {
+            ++it;
+        }
+        if (it != param_overrides.end()) {
+            param_overrides.erase(it);
+        }
+        param_overrides.emplace_back(name, value);
+    } else if (kind == "times") {
+        int id;
+        StateTimes parsed_times;
+        iss >> id;
+        for (int k = 0; k < 3; k++) {
+            iss >> parsed_times.base[k] >> parsed_times.last[k];
+        }
+        if (iss && !ClientRegistry::valid_id(id)) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (iss) {
+            state_times[id] = parsed_times;
+        }
+    } else if (kind == "drr") {
+        int id;
+        int turns[TASK_KINDS];
+        long long deficits[TASK_KINDS * 3];
+        iss >> id;
+        for (int& turn : turns) {
+            iss >> turn;
+        }
+        for (long long& deficit : deficits) {
+            iss >> deficit;
+        }
+        if (iss && (!ClientRegistry::valid_id(id) || !tasks.restore_drr(id, turns, deficits))) {
+            iss.setstate(std::ios::failbit);
+        }
+    } else if (kind == "graph") {
+        int author, reviewer, stale;
+        long long age_ms;
+        iss >> author >> reviewer >> stale >> age_ms;
+        auto valid_or_none = [](int id) { return id == -1 || ClientRegistry::valid_id(id); };
+        if (iss && (!ClientRegistry::valid_id(author) || !valid_or_none(reviewer) || !valid_or_none(stale))) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (iss) {
+            wait_graph.restore(author, reviewer, stale, age_ms);
+        }
+    } else if (kind == "rework") {
+        int reviewer;
+        int expected[3];
+        iss >> reviewer >> expected[0] >> expected[1] >> expected[2];
+        if (iss && !ClientRegistry::valid_id(reviewer)) {
+            iss.setstate(std::ios::failbit);
+        }
+        for (int author = 0; iss && author < 3; author++) {
+            rework_expected[reviewer][author] = expected[author] != 0;
+        }
+    } else if (kind == "estimator") {
+        int reviewer;
+        long long estimate_ms, reviewed_age_ms;
+        long long submit_age_ms[3];
+        iss >> reviewer >> estimate_ms >> reviewed_age_ms >> submit_age_ms[0] >> submit_age_ms[1] >> submit_age_ms[2];
+        if (iss && !ClientRegistry::valid_id(reviewer)) {
+            iss.setstate(std::ios::failbit);
+        }
+        if (iss) {
+            review_estimator.restore(reviewer, estimate_ms, reviewed_age_ms, submit_age_ms);
+        }
+    } else if (kind == "monitor") {
+        int index;
+        iss >> index;
+        if (fd_at(index) != -1) {
+            std::lock_guard<std::mutex> lock(monitor_socket_mutex);
+            monitor_socket_fds.push_back(fd_at(index));
+        }
+    }
+    if (!iss) {
+        Logger::log("Неверная строка состояния: \"" + line + "\"");
+        return false;
+    }
+    return true;
+}
+
+bool restore_state(const std::string& state, const std::vector<int>& fds, ClientRegistry& clients,
+                   TaskPool& tasks, int& listen_fd, std::vector<std::string>& recv_buffers) {
+    std::istringstream in(state);
+    std::string line;
+    int client_lines = 0;
+    while (std::getline(in, line)) {
+        if (!apply_state_line(line, fds, clients, tasks, listen_fd, &recv_buffers)) {
+            return false;
+        }
+        client_lines += line.compare(0, 7, "client ") == 0;
+    }
+    return listen_fd != -1 && client_lines == ClientRegistry::SIZE;
+}
+
+// Отправка сокетов через SCM_RIGHTS вместе с размером текста состояния, затем сам текст
+bool send_state(int channel, const std::vector<int>& fds, const std::string& state) {
+    uint64_t size = state.size();
+    struct iovec iov = {&size, sizeof(size)};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    if (sendmsg(channel, &msg, 0) != sizeof(size)) {
+        return false;
+    }
+    size_t sent = 0;
+    while (sent < state.size()) {
+        ssize_t n = send(channel, state.data() + sent, state.size() - sent, 0);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+bool receive_state(int channel, std::vector<int>& fds, std::string& state) {
+    uint64_t size = 0;
+    struct iovec iov = {&size, sizeof(size)};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * 256));
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    if (recvmsg(channel, &msg, MSG_WAITALL) != sizeof(size)) {
+        return false;
+    }
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            fds.resize(count);
+            memcpy(fds.data(), CMSG_DATA(cmsg), sizeof(int) * count);
+        }
+    }
+    state.resize(size);
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(channel, &state[received], size - received, 0);
+        if (n <= 0) {
+            return false;
+        }
+        received += n;
+    }
+    return true;
+}
+
+int unix_socket_address(const std::string& path, struct sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+// Новый процесс: подключение к работающему серверу через path и прием его сокетов и состояния.
+// false, если по этому пути никто не слушает (тогда сервер запускается обычным образом).
+bool take_over(const std::string& path, ClientRegistry& clients, TaskPool& tasks, int& listen_fd) {
+    struct sockaddr_un address;
+    int channel = unix_socket_address(path, address);
+    if (connect(channel, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(channel);
+        return false;
+    }
+    Logger::log("Найден работающий сервер (" + path + "), принимаю его сокеты и состояние...");
+    std::vector<int> fds;
+    std::string state;
+    if (!receive_state(channel, fds, state) || !restore_state(state, fds, clients, tasks, listen_fd, handoff_buffers)) {
+        Logger::log("Не удалось принять состояние старого сервера");
+        exit(1);
+    }
+    send(channel, "ok\n", 3, 0);
+    // Старый процесс закрывает канал, когда дописал свою трассу: после этого трассу можно продолжать
+    struct timeval timeout = {10, 0};
+    setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char byte;
+    recv(channel, &byte, 1, 0);
+    close(channel);
+    Logger::log("Принято сокетов: " + std::to_string(fds.size()) + ", состояние: " + std::to_string(state.size()) + " байт");
+    return true;
+}
+
+// Старый процесс: ожидание преемника на path. При подключении потоки останавливаются на границе сообщений,
+// сокеты и состояние передаются, и после подтверждения процесс завершается, не закрывая соединения.
+void handoff_listener(const std::string& path, ClientRegistry& clients, TaskPool& tasks, int listen_fd) {
+    struct sockaddr_un address;
+    int handoff_socket = unix_socket_address(path, address);
+    unlink(path.c_str());
+    if (bind(handoff_socket, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(handoff_socket, 1) < 0) {
+        Logger::log("Не удалось открыть сокет передачи " + path + ": " + strerror(errno));
+        return;
+    }
+    Logger::log("Ожидание преемника для горячего перезапуска на " + path);
+    while (break_flag) {
+        int channel = accept(handoff_socket, NULL, NULL);
+        if (channel < 0) {
+            continue;
+        }
+        Logger::log("[ПЕРЕЗАПУСК] Подключился новый процесс сервера, останавливаю обработку...");
+        std::lock_guard<std::mutex> pause_lock(pause_owner_mutex);
+        char reply[8] = {0};
+        bool done = false;
+        if (pause_all_threads()) {
+            std::vector<int> fds;
+            std::string state = serialize_state(clients, tasks, listen_fd, fds);
+            Logger::log("[ПЕРЕЗАПУСК] Передаю сокетов: " + std::to_string(fds.size()) + ", состояние: "
+                        + std::to_string(state.size()) + " байт");
+            done = send_state(channel, fds, state) && recv(channel, reply, 3, MSG_WAITALL) == 3
+                   && strncmp(reply, "ok\n", 3) == 0;
+        }
+        if (done) {
+            Logger::log("[ПЕРЕЗАПУСК] Новый процесс принял работу, старый процесс завершается");
+            // Преемник откроет трассу на дозапись только после закрытия канала
+            trace_writer.close();
+            close(channel);
+            _exit(0);
+        }
+        close(channel);
+        Logger::log("[ПЕРЕЗАПУСК] Передача не удалась, продолжаю работу");
+        handoff_pause = false;
+    }
+}
+
+// Подписка резервного сервера: при остановленных потоках отправляется снимок состояния, строка synced,
+// а дальше реплика получает изменения через replicator
+void add_replica(int replica_fd, ClientRegistry& clients, TaskPool& tasks, int listen_fd) {
+    std::lock_guard<std::mutex> pause_lock(pause_owner_mutex);
+    if (!pause_all_threads()) {
+        Logger::log("[РЕПЛИКАЦИЯ] Не удалось остановить обработку для снимка, реплика отключена");
+        close(replica_fd);
+        service_connections--;
+        return;
+    }
+    std::vector<int> fds;
+    std::string state = serialize_state(clients, tasks, listen_fd, fds) + "synced\n";
+    size_t sent = 0;
+    while (sent < state.size()) {
+        ssize_t n = send(replica_fd, state.data() + sent, state.size() - sent, 0);
+        if (n <= 0) {
             break;
-        case GET_QUEUE: 
-            task_type_str = "ответ по очереди"; 
-            emoji = "📋";
+        }
+        sent += n;
+    }
+    if (sent == state.size()) {
+        replicator.add(replica_fd);
+        Logger::log("[РЕПЛИКАЦИЯ] Реплика подключена (сокет " + std::to_string(replica_fd) + "), снимок: "
+                    + std::to_string(state.size()) + " байт");
+    } else {
+        close(replica_fd);
+    }
+    handoff_pause = false;
+    service_connections--;
+}
+
+// Резервный сервер: подписка на поток репликации основного сервера и применение изменений.
+// Если основной сервер пропал и не отвечает на повторные подключения, возвращает управление,
+// и резервный сервер начинает принимать клиентов с уже восстановленным состоянием.
+// false, если резервный сервер остановлен по Ctrl+C до переключения.
+bool run_standby(const std::string& primary, ClientRegistry& clients, TaskPool& tasks) {
+    size_t colon = primary.rfind(':');
+    struct sockaddr_in primary_addr;
+    primary_addr.sin_family = AF_INET;
+    primary_addr.sin_addr.s_addr = inet_addr(primary.substr(0, colon).c_str());
+    primary_addr.sin_port = htons(atoi(primary.substr(colon + 1).c_str()));
+
+    bool synced_once = false;
+    int failed_attempts = 0;
+    // До первой синхронизации ждем основной сервер сколько угодно, после - 5 попыток
+    while (break_flag && (!synced_once || failed_attempts < 5)) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr *)&primary_addr, sizeof(primary_addr)) < 0) {
+            close(fd);
+            failed_attempts++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(synced_once ? 300 : 1000));
+            continue;
+        }
+        std::string hello = std::string(command_name(Command::REPLICA)) + "\n";
+        send(fd, hello.c_str(), hello.size(), 0);
+
+        // Каждая подписка начинается с полного снимка
+        mailboxes = std::vector<Mailbox>(3);
+        tasks.clear();
+        param_overrides.clear();
+        state_times = std::vector<StateTimes>(3);
+        {
+            std::lock_guard<std::mutex> lock(monitor_socket_mutex);
+            monitor_socket_fds.clear();
+        }
+        int unused_listen_fd = -1;
+        std::vector<int> no_fds;
+
+        std::string recv_buffer;
+        char buffer[4096];
+        long long applied = 0;
+        int n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            recv_buffer.append(buffer, n);
+            size_t consumed = 0;
+            size_t pos;
+            while ((pos = recv_buffer.find('\n', consumed)) != std::string::npos) {
+                std::string line = recv_buffer.substr(consumed, pos - consumed);
+                consumed = pos + 1;
+                if (line == "synced") {
+                    synced_once = true;
+                    failed_attempts = 0;
+                    Logger::log("[РЕЗЕРВ] Получен снимок состояния основного сервера " + primary
+                                + ", дальше применяются изменения");
+                } else if (apply_state_line(line, no_fds, clients, tasks, unused_listen_fd, nullptr)) {
+                    applied++;
+                }
+            }
+            recv_buffer.erase(0, consumed);
+        }
+        close(fd);
+        if (synced_once && break_flag) {
+            Logger::log("[РЕЗЕРВ] Поток репликации прерван (применено строк: " + std::to_string(applied)
+                        + "), проверяю основной сервер...");
+        }
+    }
+    if (!break_flag) {
+        return false;
+    }
+    // Сокеты клиентов основного сервера в снимке не передаются, поэтому все ID свободны.
+    // Отключение считается с момента переключения, чтобы клиенты успели переподключиться до тревог.
+    for (int id = 0; id < ClientRegistry::SIZE; id++) {
+        wait_graph.connection(id, false);
+    }
+    Logger::log("[РЕЗЕРВ] Основной сервер " + primary + " недоступен, перехожу в режим основного сервера");
+    return true;
+}
+
+// Закрепление потоков за ядрами (--pin). Потоки нумеруются: 0-2 - клиенты, 3 - наблюдатель, 4 - прием подключений;
+// поток с номером k получает ядро pin_cpus[k % размер]. В режиме rx поток клиента переходит на ядро,
+// на котором ядро ОС принимает пакеты его соединения (SO_INCOMING_CPU), и данные соединения не ходят между ядрами.
+std::vector<int> pin_cpus;
+bool pin_to_rx = false;
+
+// NUMA-узел ядра по /sys; -1, если узлов нет
+int cpu_numa_node(int cpu) {
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL) {
+        return -1;
+    }
+    int node = -1;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
             break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+// Память, которую поток впервые заполняет после закрепления, выделяется на его NUMA-узле,
+// а glibc дает каждому потоку свою арену malloc, поэтому буферы потока остаются локальными.
+bool pin_current_thread(int cpu, const std::string& thread_name) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        Logger::log("[ЯДРА] Не удалось закрепить " + thread_name + " за ядром " + std::to_string(cpu) + ": " + strerror(error));
+        return false;
+    }
+    Logger::log("[ЯДРА] " + thread_name + " закреплен за ядром " + std::to_string(cpu)
+                + " (NUMA-узел " + std::to_string(cpu_numa_node(cpu)) + ")");
+    return true;
+}
+
+void pin_thread(int index, const std::string& thread_name) {
+    if (!pin_cpus.empty()) {
+        pin_current_thread(pin_cpus[index % pin_cpus.size()], thread_name);
     }
-    
-    Logger::log("Сообщение клиенту (сокет " + std::to_string(socket_fd) + "): \"" 
-              + message.substr(0, message.size()-1) + "\" [" + task_type_str + "]");
-    send(socket_fd, message.c_str(), message.size(), 0);
 }
 
+// Ядро, на котором принимаются пакеты соединения; -1, если неизвестно
+int incoming_cpu(int socket_fd) {
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) {
+        return -1;
+    }
+    return cpu;
+}
+
+// "rx" или список ядер через запятую
+bool parse_pin(const std::string& spec) {
+    if (spec == "rx") {
+        pin_to_rx = true;
+        return true;
+    }
+    long cpus_count = sysconf(_SC_NPROCESSORS_CONF);
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end;
+        long cpu = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || cpu < 0 || cpu >= cpus_count) {
+            return false;
+        }
+        pin_cpus.push_back(cpu);
+    }
+    return !pin_cpus.empty();
+}
 
 void sigint_handler(int sig) {
     break_flag = 0;
@@ -97,8 +2150,50 @@ void sigint_handler(int sig) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт>" << std::endl;
+    std::string trace_path;
+    std::string handoff_path;
+    std::string standby_primary;
+    bool valid_args = argc >= 3 && argc % 2 == 1;
+    for (int i = 3; valid_args && i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--trace") == 0) {
+            trace_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--handoff") == 0) {
+            handoff_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--queue-policy") == 0
+                   && (strcmp(argv[i + 1], "fifo") == 0 || strcmp(argv[i + 1], "priority") == 0)) {
+            queue_policy = strcmp(argv[i + 1], "fifo") == 0 ? QUEUE_FIFO : QUEUE_PRIORITY;
+        } else if (strcmp(argv[i], "--weights") == 0) {
+            // Веса через запятую для ID 0, 1, 2
+            std::istringstream weights(argv[i + 1]);
+            std::string weight;
+            for (int id = 0; id < 3 && valid_args; id++) {
+                valid_args = static_cast<bool>(std::getline(weights, weight, ',')) && atof(weight.c_str()) > 0;
+                if (valid_args) {
+                    submitter_weights[id] = atof(weight.c_str());
+                }
+            }
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            valid_args = parse_pin(argv[i + 1]);
+        } else if (strcmp(argv[i], "--stall-timeout") == 0 && atof(argv[i + 1]) > 0) {
+            stall_seconds = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--reassign") == 0 && atof(argv[i + 1]) >= 0) {
+            reassign_seconds = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--aging") == 0 && atof(argv[i + 1]) > 0) {
+            aging_seconds = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--max-in-flight") == 0 && atoi(argv[i + 1]) > 0) {
+            max_in_flight = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--standby") == 0 && strchr(argv[i + 1], ':') != NULL) {
+            standby_primary = argv[i + 1];
+        } else {
+            valid_args = false;
+        }
+    }
+    if (!valid_args) {
+        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт> [--trace <файл>] [--handoff <unix-сокет>]"
+                  << " [--standby <адрес основного сервера>:<порт>] [--max-in-flight N]"
+                  << " [--queue-policy fifo|priority] [--aging S]"
+                  << " [--weights w0,w1,w2] [--stall-timeout S] [--reassign S]"
+                  << " [--pin <ядра через запятую>|rx]" << std::endl;
         return 1;
     }
 
@@ -111,77 +2206,133 @@ int main(int argc, char *argv[]) {
     sigaction(SIGINT, &sa, NULL);
     signal(SIGPIPE, SIG_IGN);
     
-    // В очередях лежат id клиентов, для которых надо проверить код
-    std::vector<std::queue<Task> > tasks(3, std::queue<Task>());
-    
-    int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd < 0) {
-        std::cerr << "Ошибка создания сокета" << std::endl;
-        return 1;
+    std::random_device random_device;
+    std::mt19937_64 token_generator(((unsigned long long)random_device() << 32) ^ random_device() ^ time(NULL));
+    for (auto& mailbox : mailboxes) {
+        mailbox.token = token_generator();
     }
 
-    struct sockaddr_in server_addr;
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = inet_addr(host_address.c_str());
-    server_addr.sin_port = htons(port);
-
+    // В очередях лежат id клиентов, для которых надо проверить код
+    TaskPool tasks(3);
+    
+    // При горячем перезапуске слушающий сокет, клиенты и состояние приходят от работающего сервера
+    int socket_fd = -1;
+    ClientRegistry clients;
+    bool taken_over = !handoff_path.empty() && take_over(handoff_path, clients, tasks, socket_fd);
 
-    if (bind(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        std::cerr << "Ошибка привязки сокета" << std::endl;
-        return 1;
+    // Трасса открывается только после передачи работы: до этого файл еще пишет старый процесс
+    if (!trace_path.empty()) {
+        if (!trace_writer.open(trace_path, taken_over)) {
+            std::cerr << "Не удалось открыть файл трассы " << trace_path << ": " << strerror(errno) << std::endl;
+            if (!taken_over) {
+                return 1;
+            }
+        } else {
+            Logger::log(std::string(taken_over ? "Продолжение" : "Запись") + " трассы событий в " + trace_path);
+        }
     }
 
-    if (listen(socket_fd, 3) < 0) {
-        std::cerr << "Ошибка при прослушивании" << std::endl;
-        return 1;
+    // Резервный сервер до отказа основного только повторяет его состояние и клиентов не принимает
+    bool promoted = false;
+    if (!taken_over && !standby_primary.empty()) {
+        Logger::log("[РЕЗЕРВ] Подписка на состояние основного сервера " + standby_primary);
+        if (!run_standby(standby_primary, clients, tasks)) {
+            Logger::log("Резервный сервер остановлен");
+            return 0;
+        }
+        promoted = true;
     }
 
-    Logger::log("Сервер запущен и прослушивает " + host_address + ":" + std::to_string(port));
+    if (!taken_over) {
+        socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (socket_fd < 0) {
+            std::cerr << "Ошибка создания сокета" << std::endl;
+            return 1;
+        }
+
+        struct sockaddr_in server_addr;
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = inet_addr(host_address.c_str());
+        server_addr.sin_port = htons(port);
 
 
-    int connected_clients = 0;
-    std::map<int, int> clients; 
-    std::atomic<int> next_id = 0;
-    
-    while (connected_clients < 3) {
-        Logger::log("Ожидание подключения клиентов... (" + std::to_string(connected_clients) + "/3)");
-        int client_socket;
-        struct sockaddr_in client_address;
-        socklen_t client_len = sizeof(client_address);
-
-        if ((client_socket = accept(socket_fd, (struct sockaddr *) &client_address, &client_len)) < 0) {
-            Logger::log("Ошибка при принятии клиента");
+        if (bind(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+            std::cerr << "Ошибка привязки сокета" << std::endl;
+            return 1;
+        }
+
+        if (listen(socket_fd, 3) < 0) {
+            std::cerr << "Ошибка при прослушивании" << std::endl;
             return 1;
         }
 
-        char buffer[1024];
-        int n = recv(client_socket, buffer, sizeof(buffer), 0);
-        std::string message(buffer, n);
+        Logger::log("Сервер запущен и прослушивает " + host_address + ":" + std::to_string(port));
+
+
+        // После переключения с резервного сервера клиенты уже известны и сами переподключатся
+        int connected_clients = promoted ? 3 : 0;
+        std::atomic<int> next_id = 0;
+        int initial_sockets[ClientRegistry::SIZE];
+    
+        while (connected_clients < 3) {
+            Logger::log("Ожидание подключения клиентов... (" + std::to_string(connected_clients) + "/3)");
+            int client_socket;
+            struct sockaddr_in client_address;
+            socklen_t client_len = sizeof(client_address);
+
+            if ((client_socket = accept(socket_fd, (struct sockaddr *) &client_address, &client_len)) < 0) {
+                Logger::log("Ошибка при принятии клиента");
+                return 1;
+            }
+
+            char buffer[1024];
+            int n = recv(client_socket, buffer, sizeof(buffer), 0);
+            ParsedMessage hello;
+            parse_message(std::string_view(buffer, n > 0 ? n : 0), hello);
 
-        if (message == "client\n") {
-            int new_client_id = next_id++;
-            clients[new_client_id] = client_socket;
-            connected_clients++;
+            if (hello.command == Command::CLIENT && hello.count == 0) {
+                int new_client_id = next_id++;
+                initial_sockets[new_client_id] = client_socket;
+                connected_clients++;
 
-            Logger::log("Клиент #" + std::to_string(connected_clients) + " подключен с ID:" + std::to_string(new_client_id)
-                  + " (сокет: " + std::to_string(client_socket) + ", IP: " 
-                  + inet_ntoa(client_address.sin_addr) + ":" + std::to_string(ntohs(client_address.sin_port)) + ")");
+                Logger::log("Клиент #" + std::to_string(connected_clients) + " подключен с ID:" + std::to_string(new_client_id)
+                      + " (сокет: " + std::to_string(client_socket) + ", IP: " 
+                      + inet_ntoa(client_address.sin_addr) + ":" + std::to_string(ntohs(client_address.sin_port)) + ")");
                   
-        } else if (message == "monitor\n") {
-            {
-                std::lock_guard<std::mutex> lock(monitor_socket_mutex);
-                monitor_socket_fds.push_back(client_socket);
+            } else if (hello.command == Command::MONITOR) {
+                {
+                    std::lock_guard<std::mutex> lock(monitor_socket_mutex);
+                    monitor_socket_fds.push_back(client_socket);
+                }
+                Logger::log("Монитор подключен (сокет: " + std::to_string(client_socket) + ")");
+            } else if (hello.command == Command::ADMIN) {
+                if (!admit_service_connection(client_socket)) {
+                    continue;
+                }
+                Logger::log("Администратор подключен (сокет: " + std::to_string(client_socket) + ")");
+                std::string rest(buffer, n);
+                size_t hello_end = rest.find('\n');
+                rest = hello_end == std::string::npos ? "" : rest.substr(hello_end + 1);
+                std::thread(serve_admin, std::ref(clients), client_socket, rest).detach();
+            } else if (hello.command == Command::REPLICA) {
+                // Снимок имеет смысл только после старта, реплика повторит подключение
+                Logger::log("Резервный сервер подключится после старта всех клиентов (сокет: " + std::to_string(client_socket) + ")");
+                close(client_socket);
             }
-            Logger::log("Монитор подключен (сокет: " + std::to_string(client_socket) + ")");
         }
-    }
 
-    Logger::log("Все клиенты подключены. Отправка стартовых сообщений...");
-    
-    for (auto& pair : clients) {
-        std::string message = "start " + std::to_string(pair.first) + "\n";
-        Logger::log("Отправка ID:" + std::to_string(pair.first) + " клиенту (сокет: " + std::to_string(pair.second) + ")");
-        send(pair.second, message.c_str(), message.size(), 0);
+        if (promoted) {
+            Logger::log("Работа продолжена на резервном сервере: " + host_address + ":" + std::to_string(port));
+        } else {
+            Logger::log("Все клиенты подключены. Отправка стартовых сообщений...");
+
+            ClientRegistry::Guard guard(clients);
+            for (int id = 0; id < ClientRegistry::SIZE; id++) {
+                attach_client(clients, id, initial_sockets[id], 0);
+            }
+        }
+    } else {
+        Logger::log("Работа продолжена после горячего перезапуска: " + host_address + ":" + std::to_string(port));
     }
 
     Logger::log("Сервер готов к работе");
@@ -190,11 +2341,16 @@ int main(int argc, char *argv[]) {
     // Благодаря нему в мапе всегда лежит актуальное состояние сокетов
     std::thread client_thread([&]() {
         Logger::log("Запущен поток для проверки подключений клиентов");
+        pin_thread(3, "Поток наблюдателя");
 
         while (break_flag) {
-            for (auto& kv : clients) {
-                int client_id = kv.first;
-                int& sock_fd = kv.second;
+            if (handoff_pause) {
+                park_for_handoff();
+                continue;
+            }
+            ClientRegistry::Guard guard(clients);
+            for (int client_id = 0; client_id < ClientRegistry::SIZE; client_id++) {
+                int sock_fd = clients.fd(client_id);
 
                 if (sock_fd == -1) continue;
 
@@ -202,13 +2358,26 @@ int main(int argc, char *argv[]) {
                 int ret = recv(sock_fd, &buf, 1, MSG_PEEK | MSG_DONTWAIT);
                 if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
                     Logger::log("[НАБЛЮДАТЕЛЬ КЛИЕНТОВ] Клиент ID:" + std::to_string(client_id) + " отключился");
-                    close(sock_fd);
-                    {
-                        std::lock_guard<std::mutex> lock(clients_mutex);
-                        sock_fd = -1;
-                    }
+                    trace_writer.record(TRACE_DISCONNECT, client_id, -1, 0, 0);
+                    clients.disconnect(client_id, sock_fd);
+                    wait_graph.connection(client_id, false);
+                }
+            }
+
+            // Сиротские проверки отдаются третьему программисту, если он подключен
+            for (const WaitForGraph::Orphan& orphan : wait_graph.check(stall_seconds, reassign_seconds)) {
+                int target = 3 - orphan.author - orphan.reviewer;
+                if (clients.fd(target) == -1) {
+                    continue;
                 }
+                Logger::log("[ПЕРЕНАЗНАЧЕНИЕ] Проверка программы ID:" + std::to_string(orphan.author) + " передана от ID:"
+                            + std::to_string(orphan.reviewer) + " к ID:" + std::to_string(target));
+                wait_graph.reassigned(orphan.author, target);
+                submit_check(clients, tasks, target, Task{orphan.author, target, -1, TASK_NEW, std::chrono::steady_clock::now()});
+                review_estimator.submitted(target, orphan.author);
             }
+            guard.leave();
+            clients.reclaim();
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
     });
@@ -217,6 +2386,7 @@ int main(int argc, char *argv[]) {
     
     std::thread monitor_thread([&]() {
         Logger::log("Запущен поток для ожидания подключений во время работы");
+        pin_thread(4, "Поток приема подключений");
 
         int flags = fcntl(socket_fd, F_GETFL, 0);
         if (flags != -1) {
@@ -224,6 +2394,10 @@ int main(int argc, char *argv[]) {
         }
 
         while (break_flag) {
+            if (handoff_pause) {
+                park_for_handoff();
+                continue;
+            }
             struct sockaddr_in monitor_address;
             socklen_t monitor_len = sizeof(monitor_address);
             int monitor_socket = accept(socket_fd, (struct sockaddr *)&monitor_address, &monitor_len);
@@ -245,71 +2419,97 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
-            std::string message(buffer, n);
-            std::istringstream iss(message);
-            std::string cmd;
-            iss >> cmd;
-            if (cmd == "monitor") {
-                monitor_socket_fds.push_back(monitor_socket);
+            ParsedMessage hello;
+            bool valid = parse_message(std::string_view(buffer, n), hello);
+            if (hello.command == Command::MONITOR) {
+                {
+                    std::lock_guard<std::mutex> lock(monitor_socket_mutex);
+                    monitor_socket_fds.push_back(monitor_socket);
+                }
                 Logger::log("Монитор подключен (сокет: " + std::to_string(monitor_socket)
                            + ", IP: " + inet_ntoa(monitor_address.sin_addr)
                            + ":" + std::to_string(ntohs(monitor_address.sin_port)) + ")");
 
-            } else if (cmd == "client") {
-                int client_id;
-                iss >> client_id;
-                if (iss) {
+            } else if (hello.command == Command::ADMIN) {
+                if (!admit_service_connection(monitor_socket)) {
+                    continue;
+                }
+                Logger::log("Администратор подключен (сокет: " + std::to_string(monitor_socket)
+                           + ", IP: " + inet_ntoa(monitor_address.sin_addr) + ")");
+                // Команды set могли прийти в том же пакете, что и admin
+                std::string rest(buffer, n);
+                size_t hello_end = rest.find('\n');
+                rest = hello_end == std::string::npos ? "" : rest.substr(hello_end + 1);
+                std::thread(serve_admin, std::ref(clients), monitor_socket, rest).detach();
+            } else if (hello.command == Command::REPLICA) {
+                if (!admit_service_connection(monitor_socket)) {
+                    continue;
+                }
+                Logger::log("Резервный сервер подключен (сокет: " + std::to_string(monitor_socket)
+                           + ", IP: " + inet_ntoa(monitor_address.sin_addr) + ")");
+                std::thread(add_replica, monitor_socket, std::ref(clients), std::ref(tasks), socket_fd).detach();
+            } else if (hello.command == Command::CLIENT && valid) {
+                // Чтение реестра и отправка start в только что опубликованный сокет идут в секции чтения:
+                // иначе наблюдатель может отключить клиента и закрыть сокет, пока этот поток его читает
+                ClientRegistry::Guard guard(clients);
+                int client_id = hello.args[0];
+                unsigned long long token = static_cast<unsigned long long>(hello.args[1]);
+                unsigned long long acked_seq = static_cast<unsigned long long>(hello.args[2]);
+                if (hello.count >= 1) {
+                    bool has_token = hello.count >= 3;
                     // повторное подключение клиента с конкретным ID
-                    if (clients.find(client_id) == clients.end()) {
+                    if (!ClientRegistry::valid_id(client_id)) {
                         Logger::log("Клиент с ID:" + std::to_string(client_id) + " не существует. Допустимые ID: 0, 1, 2");
-                        std::string message = "break";
+                        std::string message(command_name(Command::BREAK));
                         send(monitor_socket, message.c_str(), message.size(), 0);
                         close(monitor_socket);
                         continue;
                     } else {
-                        if (clients[client_id] != -1) {
+                        if (clients.fd(client_id) != -1) {
                             Logger::log("Клиент ID:" + std::to_string(client_id) + " уже подключен.");
-                            std::string message = "break";
+                            std::string message(command_name(Command::BREAK));
                             send(monitor_socket, message.c_str(), message.size(), 0);
                             close(monitor_socket);
                             continue;
                         }
-                        clients[client_id] = monitor_socket;
-                        Logger::log("Клиент ID:" + std::to_string(client_id) + " подключен (сокет: " + std::to_string(monitor_socket) + ")");
+                        if (has_token && token != mailboxes[client_id].token) {
+                            Logger::log("Клиент ID:" + std::to_string(client_id) + " предъявил неверный токен сессии.");
+                            std::string message(command_name(Command::BREAK));
+                            send(monitor_socket, message.c_str(), message.size(), 0);
+                            close(monitor_socket);
+                            continue;
+                        }
+                        Logger::log("Клиент ID:" + std::to_string(client_id) + " подключен (сокет: " + std::to_string(monitor_socket) + ")"
+                                  + (has_token ? ", возобновление сессии с #" + std::to_string(acked_seq + 1) : ""));
 
                         // Активация клиента
-                        std::string message = "start " + std::to_string(client_id) + "\n";
-                        send(monitor_socket, message.c_str(), message.size(), 0);
+                        attach_client(clients, client_id, monitor_socket, has_token ? acked_seq : 0);
                     }
                 } else {
                     // новое подключение клиента
                     bool found_place = false;
                     int place = -1;
 
-                    {
-                        std::lock_guard<std::mutex> lock(clients_mutex);
-                        for (const auto& kv : clients) {
-                        if (kv.second == -1) {
-                                clients[kv.first] = monitor_socket;
-                                found_place = true;
-                                place = kv.first;
-                                break;
-                            }
+                    // ID занимает только этот поток, поэтому свободная ячейка не исчезнет до attach_client
+                    for (int id = 0; id < ClientRegistry::SIZE; id++) {
+                        if (clients.fd(id) == -1) {
+                            found_place = true;
+                            place = id;
+                            break;
                         }
                     }
 
                     
                     if (!found_place) {
                         Logger::log("Не удалось найти место для нового клиента. Все клиенты работают. Попробуйте позже.");
-                        std::string message = "break";
+                        std::string message(command_name(Command::BREAK));
                         send(monitor_socket, message.c_str(), message.size(), 0);
                         close(monitor_socket);
                         continue;
                     }
                     Logger::log("Клиент ID:" + std::to_string(place) + " подключен (сокет: " + std::to_string(monitor_socket) + ")");
                     // Активация клиента
-                    std::string message = "start " + std::to_string(place) + "\n";
-                    send(monitor_socket, message.c_str(), message.size(), 0);
+                    attach_client(clients, place, monitor_socket, 0);
                 }
                 
             } 
@@ -325,21 +2525,56 @@ int main(int argc, char *argv[]) {
         std::thread([&, i]() {
             
             char buffer[1024];
-            int socket_fd;
+            int socket_fd = -1;
             std::string recv_buffer;
+            Admission admission;
+            int admitted_fd = -1;
+            long long rejected_since_log = 0;
+            auto last_reject_log = std::chrono::steady_clock::now();
+            {
+                // После горячего перезапуска здесь недочитанная часть строки от старого процесса
+                std::lock_guard<std::mutex> lock(handoff_mutex);
+                recv_buffer = handoff_buffers[i];
+            }
             Logger::log("Запущен поток для клиента ID:" + std::to_string(i) + " (сокет: " + std::to_string(socket_fd) + ")");
+            pin_thread(i, "Поток клиента ID:" + std::to_string(i));
+            int pinned_cpu = -1;
+            // Буфер приема заполняется уже на ядре потока, его страницы попадают на локальный NUMA-узел
+            recv_buffer.reserve(sizeof(buffer) * 4);
 
             while (break_flag) {
-                socket_fd = clients[i];
+                if (handoff_pause) {
+                    {
+                        std::lock_guard<std::mutex> lock(handoff_mutex);
+                        handoff_buffers[i] = recv_buffer;
+                    }
+                    park_for_handoff();
+                    continue;
+                }
+                // Пока открыта секция чтения, сокет клиента не закроется, даже если наблюдатель его отключит
+                ClientRegistry::Guard guard(clients);
+                socket_fd = clients.fd(i);
 
                 if (socket_fd == -1) {
+                    guard.leave();
                     Logger::log("Клиент ID:" + std::to_string(i) + " отключился");
                     std::this_thread::sleep_for(std::chrono::seconds(1));
                     Logger::log("Жду подключения клиента ID:" + std::to_string(i));
                     continue;
                 }
+                if (socket_fd != admitted_fd) {
+                    admission.reset();
+                    admitted_fd = socket_fd;
+                    int cpu = pin_to_rx ? incoming_cpu(socket_fd) : -1;
+                    if (cpu >= 0 && cpu != pinned_cpu && pin_current_thread(cpu, "Поток клиента ID:" + std::to_string(i))) {
+                        pinned_cpu = cpu;
+                    }
+                }
 
                 int n = recv(socket_fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    guard.leave();
+                }
                 if (n == 0) {
                     Logger::log("Клиент ID:" + std::to_string(i) + " отключился");
                     std::this_thread::sleep_for(std::chrono::seconds(5));
@@ -358,60 +2593,47 @@ int main(int argc, char *argv[]) {
 
                 
                 recv_buffer.append(buffer, n);
-                size_t pos = 0;
-                std::string message;
-                while ((pos = recv_buffer.find('\n')) != std::string::npos) {
-                    message = recv_buffer.substr(0, pos);
-                    Logger::log("Получено сообщение от клиента ID:" + std::to_string(i) + ": \"" + message + "\"");
-                    recv_buffer.erase(0, pos + 1);
-                    if (message.empty()) {
-                        Logger::log("Получено пустое сообщение от клиента ID:" + std::to_string(i));
-                        continue;
+                // Строки разбираются прямо в буфере приема, обработанная часть удаляется одним erase
+                size_t consumed = 0;
+                size_t pos;
+                while ((pos = recv_buffer.find('\n', consumed)) != std::string::npos) {
+                    std::string_view message(recv_buffer.data() + consumed, pos - consumed);
+                    consumed = pos + 1;
+                    ParsedMessage parsed;
+                    bool valid = parse_message(message, parsed);
+                    if (!valid) {
+                        parsed.command = Command::UNKNOWN;
                     }
-                    if (message.substr(0, 5) == "check") {
-                        std::istringstream iss(message);
-                        std::string cmd;
-                        int to, from;
-                        iss >> cmd >> to >> from;
-                        Logger::log("Клиент ID:" + std::to_string(from) + " запрашивает проверку у клиента ID:" + std::to_string(to));
-                        tasks[to].push(Task{from, to, -1});
-    
-                        Logger::log("Задача добавлена в очередь клиента ID:" + std::to_string(to));
-
-                        send_task(clients[to], REQUEST_CHECK, to, from, 0);
-                    } else if (message.substr(0, 8) == "reviewed") {
-                        std::istringstream iss(message);
-                        std::string cmd;
-                        int to, from, result;
-                        iss >> cmd >> to >> from >> result;
-                        std::string result_str = (result == 1) ? "ПРИНЯТО" : "ОТКЛОНЕНО";
-                        Logger::log("Клиент ID:" + std::to_string(from) + " проверил клиента ID:" + std::to_string(to) 
-                                  + " с результатом: " + result_str);
-    
-                        send_task(clients[to], REVIEW_RESULT, to, from, result);
-                    } else if (message.substr(0, 5) == "queue") {
-                        std::istringstream iss(message);
-                        std::string cmd;
-                        int id;
-                        iss >> cmd >> id;
-                        Logger::log("Клиент ID:" + std::to_string(id) + " запрашивает задачи из очереди");
-                        if (tasks[id].empty()) {
-                            Logger::log("Очередь для клиента ID:" + std::to_string(id) + " пуста");
-                            send_task(clients[id], GET_QUEUE, -1, id, 0);
-                        } else {
-                            Logger::log("Отправка следующей задачи клиенту ID:" + std::to_string(id) 
-                                      + " (от клиента ID:" + std::to_string(tasks[id].front().from_id) + ")");
-                            send_task(clients[id], GET_QUEUE, tasks[id].front().from_id, id, 0);
-                            tasks[id].pop();
+
+                    // Сообщения сверх лимита не разбираются дальше и не пишутся в лог по одному:
+                    // раз в секунду выводится только их число
+                    if (!admission.admit(parsed.command)) {
+                        rejected_by_rate[i][static_cast<int>(parsed.command)]++;
+                        rejected_since_log++;
+                        send_busy(socket_fd, message);
+                        auto now = std::chrono::steady_clock::now();
+                        if (now - last_reject_log >= std::chrono::seconds(1)) {
+                            LineBuffer reject_line;
+                            reject_line << "[ЛИМИТЫ] Клиент ID:" << i << " превышает лимит частоты, отклонено сообщений: "
+                                        << rejected_since_log;
+                            Logger::log(reject_line);
+                            rejected_since_log = 0;
+                            last_reject_log = now;
                         }
-                    } else {
-                        Logger::log("Неизвестное сообщение от клиента ID:" + std::to_string(i) + ": \"" + message + "\"");
+                        continue;
                     }
+
+                    route_message(clients, tasks, i, socket_fd, message, parsed);
                 }
+                recv_buffer.erase(0, consumed);
             }
         }).detach();
     }
 
+    if (!handoff_path.empty()) {
+        std::thread(handoff_listener, handoff_path, std::ref(clients), std::ref(tasks), socket_fd).detach();
+    }
+
     Logger::log("Сервер работает. Нажмите Ctrl+C для завершения...");
 
     while (break_flag) {
@@ -419,12 +2641,18 @@ int main(int argc, char *argv[]) {
     }
 
     Logger::log("Сервер завершает работу...");
+    log_state_times();
+    log_admission_stats();
+    log_queue_waits();
 
     close(socket_fd);
-    for (auto& pair : clients) {
-        Logger::log("Закрытие сокета клиента ID:" + std::to_string(pair.first) + " (сокет: " + std::to_string(pair.second) + ")");
-        close(pair.second);
+    ClientRegistry::Guard guard(clients);
+    for (int id = 0; id < ClientRegistry::SIZE; id++) {
+        int client_socket = clients.fd(id);
+        Logger::log("Закрытие сокета клиента ID:" + std::to_string(id) + " (сокет: " + std::to_string(client_socket) + ")");
+        close(client_socket);
     }
+    trace_writer.close();
 
     Logger::log("Сервер успешно завершил работу");
     return 0;
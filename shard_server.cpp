@@ -0,0 +1,652 @@
+#include <iostream>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include "protocol.h"
+
+// Сервер многих отделов: в одном процессе работают независимые отделы по три программиста.
+// Отдел - это осколок (shard) со своими почтовыми ящиками, очередями задач и реестром подключений.
+// Отдел d обслуживает рабочий поток d % N, закрепленный за своим ядром; поток ведет все соединения
+// своих отделов в одном цикле poll, поэтому у отделов нет общих структур и мьютексов.
+// Поток приема подключений ничего не читает: он раздает новые сокеты рабочим потокам по кругу через
+// каналы (pipe). Рабочий поток читает строку "department <номер>" в своем цикле poll и, если отдел
+// чужой, передает сокет вместе с уже прочитанным началом разговора потоку-владельцу.
+// Это упрощенная отдельная программа: чего в ней нет по сравнению с server_10, перечислено в readme.
+
+const int PROGRAMMERS = 3;
+const int POLL_TIMEOUT_MS = 500; // как часто рабочий поток проверяет флаг завершения
+const size_t HANDSHAKE_LIMIT = 256; // сколько байт читается из сокета, пока номер отдела неизвестен
+const int HELLO_TIMEOUT_MS = 5000; // сколько ждать строки department и client от нового подключения
+const size_t OUTPUT_LIMIT = 1 << 20; // неотправленный хвост, после которого клиент считается зависшим
+
+volatile sig_atomic_t break_flag = 1;
+
+enum SendTaskType {
+    REQUEST_CHECK,
+    REVIEW_RESULT,
+};
+
+struct PendingMessage {
+    unsigned long long seq;
+    SendTaskType type;
+    int from_id;
+    int result;
+};
+
+// Почтовый ящик ID, как в server_10: сообщения хранятся до подтверждения "ack <id> <seq>"
+// и повторяются при возобновлении сессии
+struct Mailbox {
+    unsigned long long token = 0;
+    unsigned long long next_seq = 1;
+    unsigned long long acked_seq = 0;
+    std::deque<PendingMessage> pending;
+};
+
+struct Connection {
+    int fd;
+    int department; // -1 до строки department
+    int id; // -1 до строки client
+    std::string buffer;
+    std::string output; // то, что сокет не принял сразу; дописывается по готовности к записи (POLLOUT)
+    std::chrono::steady_clock::time_point accepted;
+};
+
+// Осколок одного отдела. Принадлежит рабочему потоку и другими потоками не читается.
+struct Department {
+    int number = -1;
+    Connection* clients[PROGRAMMERS] = {}; // реестр подключений: соединение ID или nullptr
+    Mailbox mailboxes[PROGRAMMERS];
+    std::deque<int> tasks[PROGRAMMERS]; // очередь проверки ID: от кого программы
+    long long state_ms[PROGRAMMERS][3] = {}; // последние отчеты stats: пишет, проверяет, спит
+    long long messages = 0;
+};
+
+// Сокет, переданный через канал: от потока приема подключений (отдел еще неизвестен) или от другого
+// рабочего потока вместе с прочитанным после строки department началом разговора
+struct Adoption {
+    int fd;
+    int department; // -1 - строка department еще не прочитана
+    std::chrono::steady_clock::time_point accepted; // срок на знакомство не продлевается при передаче
+    size_t length;
+    char data[HANDSHAKE_LIMIT];
+};
+static_assert(sizeof(Adoption) <= PIPE_BUF, "запись в канал должна быть атомарной");
+
+// Буфер лога рабочего потока: строки копятся в памяти и выводятся одним write за оборот цикла,
+// поэтому потоки не делят ни мьютекс, ни буфер std::cout
+class LogBuffer {
+public:
+    void log(std::string_view message) {
+        data.append(message.data(), message.size());
+        data.push_back('\n');
+    }
+
+    void log(const LineBuffer& line) {
+        log(line.view());
+    }
+
+    void flush() {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = write(STDOUT_FILENO, data.data() + written, data.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        data.clear();
+    }
+
+private:
+    std::string data;
+};
+
+class Worker {
+public:
+    Worker(int index, std::deque<Worker>& workers, int departments_count, int cpu)
+        : index(index), workers(workers), departments_count(departments_count), cpu(cpu) {
+        if (pipe(adoption_pipe) < 0) {
+            adoption_pipe[0] = adoption_pipe[1] = -1;
+        }
+    }
+
+    // Вызывается потоком приема подключений и другими рабочими потоками; запись меньше PIPE_BUF атомарна,
+    // поэтому мьютекс не нужен
+    bool adopt(int fd, int department, std::string_view data,
+               std::chrono::steady_clock::time_point accepted = std::chrono::steady_clock::now()) {
+        Adoption adoption;
+        adoption.fd = fd;
+        adoption.department = department;
+        adoption.accepted = accepted;
+        adoption.length = std::min(data.size(), sizeof(adoption.data));
+        memcpy(adoption.data, data.data(), adoption.length);
+        return write(adoption_pipe[1], &adoption, sizeof(adoption)) == sizeof(adoption);
+    }
+
+    void run() {
+        pin();
+        // Отделы создаются после закрепления, поэтому их память выделяется на NUMA-узле потока
+        std::random_device rd;
+        std::mt19937_64 token_generator((static_cast<unsigned long long>(rd()) << 32) ^ rd());
+        for (int d = index; d < departments_count; d += static_cast<int>(workers.size())) {
+            departments.emplace_back();
+            departments.back().number = d;
+            for (Mailbox& mailbox : departments.back().mailboxes) {
+                mailbox.token = token_generator();
+            }
+        }
+        log_line() << "Рабочий поток #" << index << " обслуживает отделов: " << departments.size();
+        flush_line();
+        logger.flush();
+
+        std::vector<struct pollfd> pollfds;
+        while (break_flag) {
+            pollfds.clear();
+            pollfds.push_back({adoption_pipe[0], POLLIN, 0});
+            for (const auto& conn : connections) {
+                pollfds.push_back({conn->fd, static_cast<short>(conn->output.empty() ? POLLIN : POLLIN | POLLOUT), 0});
+            }
+            int ready = poll(pollfds.data(), pollfds.size(), POLL_TIMEOUT_MS);
+            if (ready > 0) {
+                // Сначала соединения: новые из канала добавляются в конец и в этом обороте не опрашиваются
+                for (size_t i = pollfds.size() - 1; i >= 1; i--) {
+                    if (pollfds[i].revents & POLLOUT) {
+                        flush_output(*connections[i - 1]);
+                    }
+                    if (pollfds[i].revents & ~POLLOUT) {
+                        serve(i - 1);
+                    }
+                }
+                if (pollfds[0].revents & POLLIN) {
+                    take_adoptions();
+                }
+            }
+            drop_silent();
+            logger.flush();
+        }
+
+        for (const Department& department : departments) {
+            if (department.messages == 0) {
+                continue;
+            }
+            for (int id = 0; id < PROGRAMMERS; id++) {
+                const long long* t = department.state_ms[id];
+                log_line() << "[Отдел " << department.number << "] [СОСТОЯНИЯ] ID:" << id << ": пишет " << t[0] / 1000
+                           << " с, проверяет " << t[1] / 1000 << " с, спит " << t[2] / 1000 << " с";
+                flush_line();
+            }
+            log_line() << "[Отдел " << department.number << "] Обработано сообщений: " << department.messages;
+            flush_line();
+        }
+        for (const auto& conn : connections) {
+            close(conn->fd);
+        }
+        logger.flush();
+    }
+
+    long long messages() const {
+        return total_messages.load(std::memory_order_relaxed);
+    }
+
+private:
+    void pin() {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error != 0) {
+            log_line() << "[ЯДРА] Не удалось закрепить рабочий поток #" << index << " за ядром " << cpu << ": " << strerror(error);
+        } else {
+            log_line() << "[ЯДРА] Рабочий поток #" << index << " закреплен за ядром " << cpu;
+        }
+        flush_line();
+    }
+
+    // Строка лога собирается в LineBuffer потока без выделения памяти и добавляется в буфер лога
+    LineBuffer& log_line() {
+        line = LineBuffer();
+        return line;
+    }
+
+    void flush_line() {
+        logger.log(line);
+    }
+
+    Department& department_of(const Connection& conn) {
+        return departments[conn.department / workers.size()];
+    }
+
+    void take_adoptions() {
+        Adoption adoptions[8];
+        ssize_t n = read(adoption_pipe[0], adoptions, sizeof(adoptions));
+        for (ssize_t i = 0; i < n / static_cast<ssize_t>(sizeof(Adoption)); i++) {
+            const Adoption& adoption = adoptions[i];
+            connections.push_back(std::make_unique<Connection>(Connection{adoption.fd, adoption.department, -1,
+                std::string(adoption.data, adoption.length), std::string(), adoption.accepted}));
+            // Строки, прочитанные прежним потоком, poll уже не покажет, поэтому они разбираются сразу
+            if (adoption.department != -1) {
+                handle_lines(*connections.back());
+            }
+        }
+    }
+
+    // Соединение, которое не представилось строкой client за HELLO_TIMEOUT_MS, закрывается
+    void drop_silent() {
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = connections.size(); i-- > 0; ) {
+            if (connections[i]->id == -1 && now - connections[i]->accepted > std::chrono::milliseconds(HELLO_TIMEOUT_MS)) {
+                log_line() << "Подключение (сокет " << connections[i]->fd << ") не представилось за "
+                           << HELLO_TIMEOUT_MS / 1000 << " с, отключаю";
+                flush_line();
+                disconnect(i);
+            }
+        }
+    }
+
+    // Неблокирующая отправка: клиент, который медленно читает, не должен задерживать остальные отделы потока.
+    // Непринятый хвост ждет в output и дописывается, когда poll сообщит о готовности сокета к записи.
+    void send_line(Connection& conn, const LineBuffer& message) {
+        size_t sent = 0;
+        if (conn.output.empty()) {
+            ssize_t n = send(conn.fd, message.data(), message.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                return; // соединение разорвано, отключение обнаружит recv
+            }
+            sent = n > 0 ? n : 0;
+        }
+        conn.output.append(message.data() + sent, message.size() - sent);
+        if (conn.output.size() > OUTPUT_LIMIT) {
+            // Клиент не читает совсем; неподтвержденные сообщения он получит из почтового ящика при возобновлении
+            log_line() << "[Отдел " << conn.department << "] Клиент (сокет " << conn.fd << ") не принимает сообщения, отключаю";
+            flush_line();
+            conn.output.clear();
+            shutdown(conn.fd, SHUT_RDWR);
+        }
+    }
+
+    void flush_output(Connection& conn) {
+        ssize_t n = send(conn.fd, conn.output.data(), conn.output.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.output.erase(0, n);
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            conn.output.clear();
+        }
+    }
+
+    void send_task(Department& department, int id_to, const PendingMessage& entry) {
+        LineBuffer message;
+        if (entry.type == REQUEST_CHECK) {
+            message << Command::CHECK << ' ' << id_to << ' ' << entry.from_id;
+        } else {
+            message << Command::REVIEWED << ' ' << id_to << ' ' << entry.from_id << ' ' << entry.result;
+        }
+        message << ' ' << entry.seq << '\n';
+        send_line(*department.clients[id_to], message);
+    }
+
+    // Доставка check/reviewed через почтовый ящик получателя
+    void deliver(Department& department, SendTaskType type, int id_to, int id_from, int result) {
+        Mailbox& mailbox = department.mailboxes[id_to];
+        PendingMessage entry = {mailbox.next_seq++, type, id_from, result};
+        mailbox.pending.push_back(entry);
+        if (department.clients[id_to] == nullptr) {
+            log_line() << "[Отдел " << department.number << "] Клиент ID:" << id_to << " не подключен, сообщение #" << entry.seq
+                       << " сохранено в почтовом ящике (ожидают: " << mailbox.pending.size() << ")";
+            flush_line();
+            return;
+        }
+        send_task(department, id_to, entry);
+    }
+
+    void acknowledge(Department& department, int id, unsigned long long seq) {
+        Mailbox& mailbox = department.mailboxes[id];
+        mailbox.acked_seq = std::max(mailbox.acked_seq, seq);
+        while (!mailbox.pending.empty() && mailbox.pending.front().seq <= mailbox.acked_seq) {
+            mailbox.pending.pop_front();
+        }
+    }
+
+    void refuse(Connection& conn) {
+        LineBuffer message;
+        message << Command::BREAK << '\n';
+        send(conn.fd, message.data(), message.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        shutdown(conn.fd, SHUT_RDWR);
+    }
+
+    // Строка client: новое подключение или возобновление сессии, как в server_10
+    void attach(Connection& conn, const ParsedMessage& hello) {
+        Department& department = department_of(conn);
+        int id = -1;
+        if (hello.count == 0) {
+            for (int candidate = 0; candidate < PROGRAMMERS && id == -1; candidate++) {
+                if (department.clients[candidate] == nullptr) {
+                    id = candidate;
+                }
+            }
+            if (id == -1) {
+                log_line() << "[Отдел " << department.number << "] Не удалось найти место для нового клиента. Все клиенты работают.";
+                flush_line();
+                refuse(conn);
+                return;
+            }
+        } else {
+            id = hello.args[0];
+            bool has_token = hello.count >= 3;
+            if (id < 0 || id >= PROGRAMMERS || department.clients[id] != nullptr
+                || (has_token && static_cast<unsigned long long>(hello.args[1]) != department.mailboxes[id].token)) {
+                log_line() << "[Отдел " << department.number << "] Отказ в подключении клиенту ID:" << id
+                           << " (неверный ID, ID уже подключен или неверный токен сессии)";
+                flush_line();
+                refuse(conn);
+                return;
+            }
+            if (has_token) {
+                acknowledge(department, id, static_cast<unsigned long long>(hello.args[2]));
+            }
+        }
+
+        conn.id = id;
+        department.clients[id] = &conn;
+        Mailbox& mailbox = department.mailboxes[id];
+        log_line() << "[Отдел " << department.number << "] Клиент ID:" << id << " подключен (сокет: " << conn.fd << ")";
+        flush_line();
+        LineBuffer message;
+        message << Command::START << ' ' << id << ' ' << mailbox.token << '\n';
+        send_line(conn, message);
+        for (const PendingMessage& entry : mailbox.pending) {
+            send_task(department, id, entry);
+        }
+    }
+
+    void disconnect(size_t index) {
+        Connection& conn = *connections[index];
+        if (conn.id != -1) {
+            Department& department = department_of(conn);
+            if (department.clients[conn.id] == &conn) {
+                department.clients[conn.id] = nullptr;
+            }
+            log_line() << "[Отдел " << conn.department << "] Клиент ID:" << conn.id << " отключился";
+            flush_line();
+        }
+        close(conn.fd);
+        remove(index);
+    }
+
+    void remove(size_t index) {
+        connections[index] = std::move(connections.back());
+        connections.pop_back();
+    }
+
+    // Первая строка нового подключения: "department <номер>" или, без нее, уже разговор отдела 0.
+    // false, если соединение закрыто или передано другому потоку.
+    bool identify(size_t index) {
+        Connection& conn = *connections[index];
+        size_t end = conn.buffer.find('\n');
+        if (end == std::string::npos) {
+            if (conn.buffer.size() < HANDSHAKE_LIMIT) {
+                return false;
+            }
+            end = conn.buffer.size();
+        }
+        ParsedMessage parsed;
+        bool valid = parse_message(std::string_view(conn.buffer).substr(0, end), parsed);
+        int department = 0;
+        if (parsed.command == Command::DEPARTMENT || end == conn.buffer.size()) {
+            department = valid && parsed.command == Command::DEPARTMENT && parsed.count == 1 ? parsed.args[0] : -1;
+            if (department < 0 || department >= departments_count) {
+                log_line() << "Отказ в подключении (сокет " << conn.fd << "): неверный номер отдела (допустимые: 0-"
+                           << departments_count - 1 << ")";
+                flush_line();
+                LineBuffer message;
+                message << Command::BREAK << '\n';
+                send(conn.fd, message.data(), message.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+                disconnect(index);
+                return false;
+            }
+            conn.buffer.erase(0, end + 1);
+        }
+        conn.department = department;
+        size_t owner = department % workers.size();
+        if (static_cast<int>(owner) == this->index) {
+            return true;
+        }
+        if (!workers[owner].adopt(conn.fd, department, conn.buffer, conn.accepted)) {
+            close(conn.fd);
+        }
+        remove(index);
+        return false;
+    }
+
+    void serve(size_t index) {
+        char buffer[4096];
+        Connection& conn = *connections[index];
+        // Пока отдел неизвестен, читается не больше HANDSHAKE_LIMIT: прочитанное может уйти другому потоку
+        size_t limit = conn.department == -1 ? HANDSHAKE_LIMIT - conn.buffer.size() : sizeof(buffer);
+        ssize_t n = recv(conn.fd, buffer, limit, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            disconnect(index);
+            return;
+        }
+        if (n < 0) {
+            return;
+        }
+        conn.buffer.append(buffer, n);
+        if (conn.department == -1 && !identify(index)) {
+            return;
+        }
+        handle_lines(conn);
+    }
+
+    void handle_lines(Connection& conn) {
+        size_t consumed = 0;
+        size_t end;
+        while ((end = conn.buffer.find('\n', consumed)) != std::string::npos) {
+            std::string_view message(conn.buffer.data() + consumed, end - consumed);
+            consumed = end + 1;
+            handle(conn, message);
+        }
+        conn.buffer.erase(0, consumed);
+    }
+
+    static bool valid_id(long long id) {
+        return id >= 0 && id < PROGRAMMERS;
+    }
+
+    void handle(Connection& conn, std::string_view message) {
+        ParsedMessage parsed;
+        bool valid = parse_message(message, parsed);
+        if (conn.id == -1) {
+            if (parsed.command == Command::CLIENT && valid) {
+                attach(conn, parsed);
+            } else {
+                refuse(conn);
+            }
+            return;
+        }
+
+        Department& department = department_of(conn);
+        department.messages++;
+        total_messages.fetch_add(1, std::memory_order_relaxed);
+        log_line() << "[Отдел " << department.number << "] Получено сообщение от клиента ID:" << conn.id << ": \"" << message << "\"";
+        flush_line();
+        const long long* args = parsed.args;
+        if (!valid) {
+            parsed.command = Command::UNKNOWN;
+        }
+
+        switch (parsed.command) {
+        case Command::CHECK:
+            if (parsed.count >= 2 && valid_id(args[0]) && valid_id(args[1])) {
+                department.tasks[args[0]].push_back(args[1]);
+                deliver(department, REQUEST_CHECK, args[0], args[1], 0);
+                return;
+            }
+            break;
+        case Command::REVIEWED:
+            if (parsed.count >= 3 && valid_id(args[0]) && valid_id(args[1])) {
+                deliver(department, REVIEW_RESULT, args[0], args[1], args[2]);
+                return;
+            }
+            break;
+        case Command::QUEUE:
+            if (parsed.count >= 1 && valid_id(args[0])) {
+                int id = args[0];
+                int from = -1;
+                if (!department.tasks[id].empty()) {
+                    from = department.tasks[id].front();
+                    department.tasks[id].pop_front();
+                }
+                LineBuffer reply;
+                reply << Command::QUEUE << ' ' << from << ' ' << id << '\n';
+                send_line(conn, reply);
+                return;
+            }
+            break;
+        case Command::ACK:
+            if (parsed.count >= 2 && valid_id(args[0])) {
+                acknowledge(department, args[0], static_cast<unsigned long long>(args[1]));
+                return;
+            }
+            break;
+        case Command::STATS:
+            if (parsed.count >= 4 && valid_id(args[0])) {
+                for (int k = 0; k < 3; k++) {
+                    department.state_ms[args[0]][k] = args[k + 1];
+                }
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        log_line() << "[Отдел " << department.number << "] Неизвестное сообщение от клиента ID:" << conn.id << ": \"" << message << "\"";
+        flush_line();
+    }
+
+    int index;
+    std::deque<Worker>& workers;
+    int departments_count;
+    int cpu;
+    int adoption_pipe[2];
+    std::vector<Department> departments; // отдел d хранится под номером d / workers.size()
+    std::vector<std::unique_ptr<Connection> > connections; // отделы ссылаются на соединения, поэтому адреса постоянны
+    LogBuffer logger;
+    LineBuffer line;
+    std::atomic<long long> total_messages{0}; // читается главным потоком только для итога
+};
+
+void sigint_handler(int sig) {
+    break_flag = 0;
+}
+
+int main(int argc, char *argv[]) {
+    int departments_count = 1;
+    int workers_count = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    bool valid_args = argc >= 3 && argc % 2 == 1;
+    for (int i = 3; valid_args && i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--departments") == 0 && atoi(argv[i + 1]) > 0) {
+            departments_count = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--workers") == 0 && atoi(argv[i + 1]) > 0) {
+            workers_count = atoi(argv[i + 1]);
+        } else {
+            valid_args = false;
+        }
+    }
+    if (!valid_args) {
+        std::cerr << "Использование: " << argv[0] << " <адрес сервера> <порт> [--departments N] [--workers N]" << std::endl;
+        return 1;
+    }
+    workers_count = std::min(workers_count, departments_count);
+
+    std::string host_address = argv[1];
+    int port = atoi(argv[2]);
+
+    int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        std::cerr << "Ошибка создания сокета" << std::endl;
+        return 1;
+    }
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(host_address.c_str());
+    server_addr.sin_port = htons(port);
+    if (bind(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Ошибка привязки сокета" << std::endl;
+        return 1;
+    }
+    if (listen(socket_fd, SOMAXCONN) < 0) {
+        std::cerr << "Ошибка при прослушивании" << std::endl;
+        return 1;
+    }
+    std::cout << "Сервер отделов запущен и прослушивает " << host_address << ":" << port
+              << " (отделов: " << departments_count << ", рабочих потоков: " << workers_count << ")" << std::endl;
+
+    // SIGINT получает только поток приема подключений: его accept прерывается, и он завершает работу
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t sigint_set;
+    sigemptyset(&sigint_set);
+    sigaddset(&sigint_set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint_set, NULL);
+
+    long cpus_count = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    // Потоки запускаются после создания всех рабочих: любой из них может передать сокет любому другому
+    std::deque<Worker> workers;
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers_count; w++) {
+        workers.emplace_back(w, workers, departments_count, w % cpus_count);
+    }
+    for (Worker& worker : workers) {
+        threads.emplace_back(&Worker::run, &worker);
+    }
+
+    struct sigaction sa;
+    sa.sa_handler = &sigint_handler;
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    pthread_sigmask(SIG_UNBLOCK, &sigint_set, NULL);
+
+    auto started = std::chrono::steady_clock::now();
+    int next_worker = 0;
+    while (break_flag) {
+        int client_socket = accept(socket_fd, NULL, NULL);
+        if (client_socket < 0) {
+            continue;
+        }
+        // Поток приема не ждет данных от клиента: молчащее подключение не задерживает остальных
+        if (!workers[next_worker].adopt(client_socket, -1, std::string_view())) {
+            close(client_socket);
+        }
+        next_worker = (next_worker + 1) % workers_count;
+    }
+
+    std::cout << "Сервер отделов завершает работу..." << std::endl;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    long long total = 0;
+    for (const Worker& worker : workers) {
+        total += worker.messages();
+    }
+    std::cout << "Обработано сообщений: " << total << " за " << static_cast<long long>(seconds) << " с ("
+              << static_cast<long long>(total / std::max(seconds, 1e-3)) << " в секунду)" << std::endl;
+    close(socket_fd);
+    return 0;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Быстрый генератор xoshiro256** (Blackman, Vigna). Состояние заполняется через splitmix64,
+// поэтому разные потоки с одним базовым зерном и разными номерами потока получают независимые последовательности.
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed = 0, uint64_t stream = 0) {
+        reseed(seed, stream);
+    }
+
+    void reseed(uint64_t seed, uint64_t stream) {
+        uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+        for (auto& word : state) {
+            word = splitmix64(x);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Равномерно на [0, 1)
+    double uniform01() {
+        return (next() >> 11) * 0x1.0p-53;
+    }
+
+    // Равномерно среди целых [0, n)
+    uint64_t below(uint64_t n) {
+        return static_cast<uint64_t>(uniform01() * n);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t state[4];
+};
+
+// Генератор текущего потока. Каждый поток перед использованием вызывает seed_thread_rng со своим номером.
+inline Xoshiro256& thread_rng() {
+    thread_local Xoshiro256 rng;
+    return rng;
+}
+
+inline void seed_thread_rng(uint64_t seed, uint64_t stream) {
+    thread_rng().reseed(seed, stream);
+}
+
+// Распределение длительностей (в секундах) и исходов. Задается строкой:
+//   uniform:a:b        - равномерное на [a, b]
+//   exp:mean           - экспоненциальное со средним mean
+//   lognormal:mu:sigma - логнормальное, mu и sigma - параметры нормального распределения логарифма
+//   bernoulli:p        - 1 с вероятностью p, иначе 0
+//   const:x            - всегда x
+struct Distribution {
+    enum Kind { CONSTANT, UNIFORM, EXPONENTIAL, LOGNORMAL, BERNOULLI };
+
+    Kind kind = CONSTANT;
+    double a = 0;
+    double b = 0;
+
+    static Distribution uniform(double low, double high) {
+        Distribution d;
+        d.kind = UNIFORM;
+        d.a = low;
+        d.b = high;
+        return d;
+    }
+
+    static Distribution bernoulli(double p) {
+        Distribution d;
+        d.kind = BERNOULLI;
+        d.a = p;
+        return d;
+    }
+
+    double sample(Xoshiro256& rng) const {
+        switch (kind) {
+            case CONSTANT:
+                return a;
+            case UNIFORM:
+                return a + (b - a) * rng.uniform01();
+            case EXPONENTIAL:
+                return -a * std::log(1.0 - rng.uniform01());
+            case LOGNORMAL: {
+                // Преобразование Бокса-Мюллера
+                double u1 = 1.0 - rng.uniform01();
+                double u2 = rng.uniform01();
+                double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+                return std::exp(a + b * normal);
+            }
+            case BERNOULLI:
+                return rng.uniform01() < a ? 1.0 : 0.0;
+        }
+        return a;
+    }
+
+    // Среднее значение, используется для оценок (например, ожидаемого времени проверки)
+    double mean() const {
+        switch (kind) {
+            case CONSTANT: return a;
+            case UNIFORM: return (a + b) / 2;
+            case EXPONENTIAL: return a;
+            case LOGNORMAL: return std::exp(a + b * b / 2);
+            case BERNOULLI: return a;
+        }
+        return a;
+    }
+
+    static bool parse(const std::string& spec, Distribution& out) {
+        size_t colon = spec.find(':');
+        std::string name = spec.substr(0, colon);
+        double params[2] = {0, 0};
+        int count = 0;
+        while (colon != std::string::npos && count < 2) {
+            size_t next = spec.find(':', colon + 1);
+            char* end;
+            std::string text = spec.substr(colon + 1, next == std::string::npos ? std::string::npos : next - colon - 1);
+            params[count++] = strtod(text.c_str(), &end);
+            if (*end != '\0' || text.empty()) {
+                return false;
+            }
+            colon = next;
+        }
+        if (colon != std::string::npos) {
+            return false;
+        }
+
+        Distribution d;
+        d.a = params[0];
+        d.b = params[1];
+        if (name == "const" && count == 1) {
+            d.kind = CONSTANT;
+        } else if (name == "uniform" && count == 2 && d.a <= d.b) {
+            d.kind = UNIFORM;
+        } else if (name == "exp" && count == 1 && d.a > 0) {
+            d.kind = EXPONENTIAL;
+        } else if (name == "lognormal" && count == 2 && d.b >= 0) {
+            d.kind = LOGNORMAL;
+        } else if (name == "bernoulli" && count == 1 && d.a >= 0 && d.a <= 1) {
+            d.kind = BERNOULLI;
+        } else {
+            return false;
+        }
+        out = d;
+        return true;
+    }
+
+    std::string describe() const {
+        switch (kind) {
+            case CONSTANT: return "const:" + format(a);
+            case UNIFORM: return "uniform:" + format(a) + ":" + format(b);
+            case EXPONENTIAL: return "exp:" + format(a);
+            case LOGNORMAL: return "lognormal:" + format(a) + ":" + format(b);
+            case BERNOULLI: return "bernoulli:" + format(a);
+        }
+        return "";
+    }
+
+private:
+    static std::string format(double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%g", value);
+        return text;
+    }
+};
+
+// Параметры модели отдела: распределения времени написания и проверки и вероятность принять программу.
+// Могут меняться во время работы командой администратора "set <параметр> <значение>".
+struct ModelParams {
+    Distribution write_time = Distribution::uniform(1, 10);
+    Distribution review_time = Distribution::uniform(1, 10);
+    double accept_probability = 0.5;
+
+    // Параметры: write и review (распределение времени), accept (вероятность от 0 до 1).
+    // false и текст ошибки, если параметр неизвестен или значение неверно.
+    bool set(const std::string& name, const std::string& value, std::string& error) {
+        if (name == "write" || name == "review") {
+            Distribution d;
+            if (!Distribution::parse(value, d) || d.kind == Distribution::BERNOULLI) {
+                error = "неверное распределение " + value + " (допустимые: uniform:a:b, exp:mean, lognormal:mu:sigma, const:x)";
+                return false;
+            }
+            (name == "write" ? write_time : review_time) = d;
+            return true;
+        }
+        if (name == "accept") {
+            char* end;
+            double p = strtod(value.c_str(), &end);
+            if (value.empty() || *end != '\0' || p < 0 || p > 1) {
+                error = "вероятность принятия должна быть числом от 0 до 1: " + value;
+                return false;
+            }
+            accept_probability = p;
+            return true;
+        }
+        error = "неизвестный параметр " + name + " (допустимые: write, review, accept)";
+        return false;
+    }
+};
@@ -0,0 +1,479 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include "sim_random.h"
+#include "work_policy.h"
+
+// Перебор параметров модели отдела методом Монте-Карло.
+// Та же модель, что у client_10 и server_10: программист пишет программу, отправляет ее на проверку
+// случайному коллеге (исправленную - тому же проверяющему), а пока ждет заключения, проверяет чужие программы.
+// Следующая работа выбирается той же политикой, что и в клиенте. Вместо сокетов и sleep - дискретно-событийная
+// симуляция, поэтому один прогон на часы модельного времени занимает миллисекунды.
+// Для каждой точки сетки запускается несколько независимых прогонов (реплик) с разными зернами,
+// реплики раздаются потокам через пул с перехватом задач, итоги пишутся в CSV с 95% доверительными интервалами.
+
+struct ModelPoint {
+    int team;
+    double accept;
+    Distribution write_time;
+    Distribution review_time;
+    WorkPolicy policy;
+};
+
+// Итоги одного прогона, время в секундах модельного времени
+struct ReplicaResult {
+    double throughput = 0;  // принятых программ в час
+    double cycle_time = 0;  // от начала написания программы до ее принятия
+    double review_wait = 0; // от отправки на проверку до начала проверки
+    double review_wait_p99 = 0;
+    double utilization = 0; // доля времени, занятая написанием и проверкой
+};
+
+const int METRICS_COUNT = 5;
+const char* metric_names[METRICS_COUNT] = {"throughput_per_hour", "cycle_time", "review_wait", "review_wait_p99", "utilization"};
+
+double metric(const ReplicaResult& r, int index) {
+    switch (index) {
+        case 0: return r.throughput;
+        case 1: return r.cycle_time;
+        case 2: return r.review_wait;
+        case 3: return r.review_wait_p99;
+        default: return r.utilization;
+    }
+}
+
+struct SimJob {
+    JobKind kind;
+    int peer;        // автор программы для REVIEW_JOB, проверяющий для VERDICT_JOB
+    int result;      // заключение для VERDICT_JOB
+    double duration; // проверка или написание (новой либо исправленной программы)
+    long long order;
+    double arrived;
+};
+
+class Simulation {
+public:
+    Simulation(const ModelPoint& point, double horizon, Xoshiro256& rng)
+        : point(point), horizon(horizon), warmup(horizon * WARMUP_SHARE), rng(rng), programmers(point.team) {}
+
+    ReplicaResult run() {
+        for (int id = 0; id < point.team; id++) {
+            start_writing(id, 0);
+        }
+        while (!events.empty() && events.top().time <= horizon) {
+            Event ev = events.top();
+            events.pop();
+            finish(ev.id, ev.time);
+        }
+
+        ReplicaResult result;
+        double window = horizon - warmup;
+        result.throughput = accepted * 3600.0 / window;
+        result.cycle_time = cycles.empty() ? 0 : sum(cycles) / cycles.size();
+        result.review_wait = waits.empty() ? 0 : sum(waits) / waits.size();
+        if (!waits.empty()) {
+            size_t k = std::min(waits.size() - 1, static_cast<size_t>(waits.size() * 0.99));
+            std::nth_element(waits.begin(), waits.begin() + k, waits.end());
+            result.review_wait_p99 = waits[k];
+        }
+        result.utilization = busy_time / (window * point.team);
+        return result;
+    }
+
+private:
+    static constexpr double WARMUP_SHARE = 0.1; // начало прогона не учитывается, пока очереди не установились
+
+    enum State { IDLE, WRITING, REVIEWING };
+
+    struct Programmer {
+        State state = IDLE;
+        std::vector<SimJob> jobs;
+        int reviewing_author = -1;
+        int last_checker = -1;
+        bool rework = false;
+        double cycle_start = 0;
+    };
+
+    struct Event {
+        double time;
+        long long order;
+        int id;
+        bool operator<(const Event& other) const {
+            return time != other.time ? time > other.time : order > other.order;
+        }
+    };
+
+    static double sum(const std::vector<double>& values) {
+        double total = 0;
+        for (double v : values) total += v;
+        return total;
+    }
+
+    void schedule(int id, double now, double duration) {
+        // Учитываем только часть занятости, попавшую в окно измерения
+        double from = std::max(now, warmup);
+        double to = std::min(now + duration, horizon);
+        if (to > from) {
+            busy_time += to - from;
+        }
+        events.push({now + duration, next_order++, id});
+    }
+
+    void start_writing(int id, double now) {
+        Programmer& p = programmers[id];
+        p.state = WRITING;
+        p.rework = false;
+        p.cycle_start = now;
+        schedule(id, now, point.write_time.sample(rng));
+    }
+
+    void push_job(int id, const SimJob& job, double now) {
+        programmers[id].jobs.push_back(job);
+        if (programmers[id].state == IDLE) {
+            start_next(id, now);
+        }
+    }
+
+    void start_next(int id, double now) {
+        Programmer& p = programmers[id];
+        if (p.jobs.empty()) {
+            p.state = IDLE;
+            return;
+        }
+        size_t best = 0;
+        for (size_t i = 1; i < p.jobs.size(); i++) {
+            if (job_before(p.jobs[i], p.jobs[best], point.policy)) {
+                best = i;
+            }
+        }
+        SimJob job = p.jobs[best];
+        p.jobs.erase(p.jobs.begin() + best);
+
+        if (job.kind == REVIEW_JOB) {
+            if (now >= warmup) {
+                waits.push_back(now - job.arrived);
+            }
+            p.state = REVIEWING;
+            p.reviewing_author = job.peer;
+            schedule(id, now, job.duration);
+        } else {
+            // Написание новой программы после принятия или исправление после отказа
+            p.state = WRITING;
+            p.rework = job.result == 0;
+            if (!p.rework) {
+                p.cycle_start = now;
+            }
+            schedule(id, now, job.duration);
+        }
+    }
+
+    void finish(int id, double now) {
+        Programmer& p = programmers[id];
+        if (p.state == WRITING) {
+            int checker = p.last_checker;
+            if (!p.rework || checker < 0) {
+                checker = static_cast<int>(rng.below(point.team - 1));
+                if (checker >= id) {
+                    checker++;
+                }
+            }
+            p.last_checker = checker;
+            SimJob job = {REVIEW_JOB, id, 0, point.review_time.sample(rng), next_order++, now};
+            push_job(checker, job, now);
+        } else if (p.state == REVIEWING) {
+            int author = p.reviewing_author;
+            int verdict = rng.uniform01() < point.accept ? 1 : 0;
+            if (verdict && now >= warmup) {
+                accepted++;
+                cycles.push_back(now - programmers[author].cycle_start);
+            }
+            SimJob job = {VERDICT_JOB, id, verdict, point.write_time.sample(rng), next_order++, now};
+            push_job(author, job, now);
+        }
+        // Проверяющий всегда отличается от автора, поэтому работа выше ушла другому программисту
+        p.state = IDLE;
+        start_next(id, now);
+    }
+
+    const ModelPoint& point;
+    double horizon;
+    double warmup;
+    Xoshiro256& rng;
+    std::vector<Programmer> programmers;
+    std::priority_queue<Event> events;
+    long long next_order = 0;
+
+    long long accepted = 0;
+    std::vector<double> cycles;
+    std::vector<double> waits;
+    double busy_time = 0;
+};
+
+// Пул потоков с перехватом задач: у каждого потока своя очередь, свои задачи он берет с конца,
+// а опустевший поток забирает задачи с начала чужих очередей. Реплики сильно различаются по длительности
+// (размер команды, горизонт), поэтому статическое деление работы оставляло бы потоки без дела.
+class StealingPool {
+public:
+    explicit StealingPool(int threads) : queues(threads) {}
+
+    void add(int worker, int task) {
+        queues[worker % queues.size()].tasks.push_back(task);
+    }
+
+    template <typename F>
+    void run(F&& execute) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < queues.size(); i++) {
+            threads.emplace_back([this, i, &execute]() {
+                int task;
+                while (take(i, task)) {
+                    execute(task);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    bool take(size_t worker, int& task) {
+        {
+            std::lock_guard<std::mutex> lock(queues[worker].mutex);
+            if (!queues[worker].tasks.empty()) {
+                task = queues[worker].tasks.back();
+                queues[worker].tasks.pop_back();
+                return true;
+            }
+        }
+        // Новые задачи во время работы не появляются, поэтому один пустой проход по всем очередям - конец работы
+        for (size_t k = 1; k < queues.size(); k++) {
+            WorkerQueue& victim = queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<WorkerQueue> queues;
+};
+
+// Квантиль t-распределения Стьюдента для двустороннего 95% интервала
+double t_quantile(int df) {
+    static const double table[] = {0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df <= 30) {
+        return table[df];
+    }
+    return df <= 60 ? 2.000 : (df <= 120 ? 1.980 : 1.960);
+}
+
+// Среднее и полуширина 95% доверительного интервала
+void confidence_interval(const std::vector<double>& values, double& mean, double& half_width) {
+    size_t n = values.size();
+    mean = 0;
+    for (double v : values) mean += v;
+    mean /= n;
+    half_width = 0;
+    if (n > 1) {
+        double squares = 0;
+        for (double v : values) squares += (v - mean) * (v - mean);
+        half_width = t_quantile(n - 1) * std::sqrt(squares / (n - 1) / n);
+    }
+}
+
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+void usage(const char* name) {
+    std::cerr << "Использование: " << name << " [--team 3,5] [--accept 0.3,0.5] [--write-dist D1,D2] [--review-dist D1,D2]\n"
+              << "    [--policy oldest,shortest|all] [--replicas N] [--horizon S] [--threads T] [--seed S] [--out file.csv]" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<int> teams = {3};
+    std::vector<double> accepts = {0.5};
+    std::vector<Distribution> write_dists = {Distribution::uniform(1, 10)};
+    std::vector<Distribution> review_dists = {Distribution::uniform(1, 10)};
+    std::vector<WorkPolicy> policies = {OLDEST_FIRST};
+    int replicas = 30;
+    double horizon = 8 * 3600; // рабочий день модельного времени
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed = (static_cast<uint64_t>(time(NULL)) << 20) ^ getpid();
+    std::string out_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        std::vector<std::string> items = split_list(value);
+        if (arg == "--team") {
+            teams.clear();
+            for (auto& item : items) {
+                int team = atoi(item.c_str());
+                if (team < 2) {
+                    std::cerr << "В команде должно быть хотя бы 2 программиста: " << item << std::endl;
+                    return 1;
+                }
+                teams.push_back(team);
+            }
+        } else if (arg == "--accept") {
+            accepts.clear();
+            for (auto& item : items) {
+                double p = atof(item.c_str());
+                if (p <= 0 || p > 1) {
+                    std::cerr << "Вероятность принятия должна быть в (0, 1]: " << item << std::endl;
+                    return 1;
+                }
+                accepts.push_back(p);
+            }
+        } else if (arg == "--write-dist" || arg == "--review-dist") {
+            std::vector<Distribution>& target = arg == "--write-dist" ? write_dists : review_dists;
+            target.clear();
+            for (auto& item : items) {
+                Distribution d;
+                if (!Distribution::parse(item, d) || d.kind == Distribution::BERNOULLI) {
+                    std::cerr << "Неверное распределение времени " << item << std::endl;
+                    return 1;
+                }
+                target.push_back(d);
+            }
+        } else if (arg == "--policy") {
+            policies.clear();
+            if (value == "all") {
+                for (int p = 0; p <= SHORTEST_FIRST; p++) {
+                    policies.push_back(static_cast<WorkPolicy>(p));
+                }
+            }
+            for (auto& item : items) {
+                WorkPolicy policy;
+                if (value == "all") {
+                    break;
+                }
+                if (!parse_policy(item, policy)) {
+                    std::cerr << "Неизвестная политика " << item << std::endl;
+                    return 1;
+                }
+                policies.push_back(policy);
+            }
+        } else if (arg == "--replicas") {
+            replicas = atoi(value.c_str());
+        } else if (arg == "--horizon") {
+            horizon = atof(value.c_str());
+        } else if (arg == "--threads") {
+            threads = atoi(value.c_str());
+        } else if (arg == "--seed") {
+            seed = strtoull(value.c_str(), NULL, 10);
+        } else if (arg == "--out") {
+            out_path = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (teams.empty() || accepts.empty() || write_dists.empty() || review_dists.empty() || policies.empty()
+        || replicas < 1 || horizon <= 0 || threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<ModelPoint> points;
+    for (int team : teams)
+        for (double accept : accepts)
+            for (auto& write_time : write_dists)
+                for (auto& review_time : review_dists)
+                    for (WorkPolicy policy : policies)
+                        points.push_back({team, accept, write_time, review_time, policy});
+
+    int tasks = points.size() * replicas;
+    std::cerr << "Точек сетки: " << points.size() << ", реплик на точку: " << replicas << ", потоков: " << threads
+              << ", зерно: " << seed << std::endl;
+
+    // Задачи раздаются по кругу, результаты пишутся каждая в свою ячейку, поэтому синхронизация не нужна
+    std::vector<ReplicaResult> results(tasks);
+    std::atomic<int> completed(0);
+    StealingPool pool(threads);
+    for (int task = 0; task < tasks; task++) {
+        pool.add(task, task);
+    }
+    auto started = std::chrono::steady_clock::now();
+    pool.run([&](int task) {
+        // Зерно зависит только от номера задачи, поэтому результат не зависит от числа потоков
+        Xoshiro256 rng(seed, task);
+        Simulation sim(points[task / replicas], horizon, rng);
+        results[task] = sim.run();
+        completed++;
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cerr << "Выполнено прогонов: " << completed << " за " << seconds << " с" << std::endl;
+
+    std::ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path);
+        if (!file) {
+            std::cerr << "Не удалось открыть " << out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = out_path.empty() ? std::cout : file;
+    out << "team,accept,write_dist,review_dist,policy,replicas";
+    for (int m = 0; m < METRICS_COUNT; m++) {
+        out << "," << metric_names[m] << "," << metric_names[m] << "_ci95";
+    }
+    out << "\n";
+    for (size_t i = 0; i < points.size(); i++) {
+        const ModelPoint& point = points[i];
+        out << point.team << "," << point.accept << "," << point.write_time.describe() << ","
+            << point.review_time.describe() << "," << policy_names[point.policy] << "," << replicas;
+        for (int m = 0; m < METRICS_COUNT; m++) {
+            std::vector<double> values;
+            for (int r = 0; r < replicas; r++) {
+                values.push_back(metric(results[i * replicas + r], m));
+            }
+            double mean, half_width;
+            confidence_interval(values, mean, half_width);
+            out << "," << mean << "," << half_width;
+        }
+        out << "\n";
+    }
+    if (!out_path.empty()) {
+        std::cerr << "Результаты записаны в " << out_path << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Бинарная трасса событий сервера.
+// Файл: заголовок (магия "IHWTRACE", версия, размер записи), затем записи TraceRecord подряд.
+// Файл перезаписывается при каждом запуске сервера. Преемник при горячем перезапуске дописывает
+// в тот же файл: клиенты, почтовые ящики и шкала времени у него те же, поэтому трасса остается одной работой.
+
+enum TraceEventType : uint8_t {
+    TRACE_CONNECT = 1,     // from_id - ID подключившегося клиента
+    TRACE_DISCONNECT = 2,  // from_id - ID отключившегося клиента
+    TRACE_CHECK = 3,       // from_id просит to_id проверить программу, seq - номер в почтовом ящике to_id
+    TRACE_REVIEWED = 4,    // from_id вернул to_id заключение result, seq - номер в почтовом ящике to_id
+    TRACE_QUEUE_REPLY = 5, // to_id получил из очереди программу автора from_id (-1 - очередь пуста)
+};
+
+#pragma pack(push, 1)
+struct TraceRecord {
+    uint64_t timestamp_ns; // system_clock, наносекунды от начала эпохи
+    uint8_t type;
+    int8_t from_id;
+    int8_t to_id;
+    int8_t result;
+    uint32_t seq;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(TraceRecord) == 16, "запись трассы должна занимать 16 байт");
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+const char TRACE_MAGIC[8] = {'I', 'H', 'W', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t TRACE_VERSION = 1;
+
+inline uint64_t trace_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline const char* trace_event_name(uint8_t type) {
+    switch (type) {
+        case TRACE_CONNECT: return "connect";
+        case TRACE_DISCONNECT: return "disconnect";
+        case TRACE_CHECK: return "check";
+        case TRACE_REVIEWED: return "reviewed";
+        case TRACE_QUEUE_REPLY: return "queue";
+    }
+    return "unknown";
+}
+
+// Запись трассы через фоновый поток: потоки сервера только добавляют запись в буфер под мьютексом,
+// а фоновый поток раз в 100 мс (или при заполнении буфера) меняет буферы местами и пишет их одним fwrite.
+class TraceWriter {
+public:
+    ~TraceWriter() {
+        close();
+    }
+
+    // append - продолжение трассы прежнего процесса: записи дописываются, заголовок пишется только в пустой файл
+    bool open(const std::string& path, bool append = false) {
+        file = fopen(path.c_str(), append ? "ab" : "wb");
+        if (!file) {
+            return false;
+        }
+        fseek(file, 0, SEEK_END);
+        if (ftell(file) == 0) {
+            TraceHeader header;
+            memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+            header.version = TRACE_VERSION;
+            header.record_size = sizeof(TraceRecord);
+            fwrite(&header, sizeof(header), 1, file);
+        }
+        active.reserve(FLUSH_THRESHOLD);
+        flushing.reserve(FLUSH_THRESHOLD);
+        writer = std::thread([this]() { writer_loop(); });
+        return true;
+    }
+
+    bool enabled() const {
+        return file != nullptr;
+    }
+
+    void record(TraceEventType type, int from_id, int to_id, int result, uint32_t seq) {
+        if (!file) {
+            return;
+        }
+        TraceRecord rec;
+        rec.timestamp_ns = trace_now_ns();
+        rec.type = type;
+        rec.from_id = static_cast<int8_t>(from_id);
+        rec.to_id = static_cast<int8_t>(to_id);
+        rec.result = static_cast<int8_t>(result);
+        rec.seq = seq;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        active.push_back(rec);
+        if (active.size() >= FLUSH_THRESHOLD) {
+            cv.notify_one();
+        }
+    }
+
+    void close() {
+        if (!file) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        cv.notify_one();
+        writer.join();
+        fclose(file);
+        file = nullptr;
+    }
+
+private:
+    static const size_t FLUSH_THRESHOLD = 4096;
+
+    void writer_loop() {
+        while (true) {
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait_for(lock, std::chrono::milliseconds(100),
+                            [this]() { return stopped || active.size() >= FLUSH_THRESHOLD; });
+                active.swap(flushing);
+                stop = stopped;
+            }
+            if (!flushing.empty()) {
+                fwrite(flushing.data(), sizeof(TraceRecord), flushing.size(), file);
+                fflush(file);
+                flushing.clear();
+            }
+            if (stop) {
+                return;
+            }
+        }
+    }
+
+    FILE* file = nullptr;
+    bool stopped = false;
+    std::vector<TraceRecord> active;
+    std::vector<TraceRecord> flushing;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread writer;
+};
+
+// Чтение всей трассы. Возвращает false, если файл не открылся или это не трасса.
+inline bool read_trace(const std::string& path, std::vector<TraceRecord>& records) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.record_size != sizeof(TraceRecord)) {
+        fclose(file);
+        return false;
+    }
+    TraceRecord rec;
+    while (fread(&rec, sizeof(rec), 1, file) == 1) {
+        records.push_back(rec);
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+// Работа, которая ждет программиста: чужая программа на проверку или заключение по своей
+enum JobKind {
+    REVIEW_JOB,
+    VERDICT_JOB,
+};
+
+// Политика выбора следующей работы из локального набора
+enum WorkPolicy {
+    OLDEST_FIRST,
+    REVIEWS_FIRST,
+    FIX_FIRST,
+    SHORTEST_FIRST,
+};
+
+const char* const policy_names[] = {"oldest", "reviews-first", "fix-first", "shortest"};
+
+inline bool parse_policy(const std::string& name, WorkPolicy& policy) {
+    for (int i = 0; i <= SHORTEST_FIRST; i++) {
+        if (name == policy_names[i]) {
+            policy = static_cast<WorkPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// true, если работу a нужно выполнить раньше работы b.
+// Job - любая структура с полями kind, duration (ожидаемая длительность) и order (порядок поступления).
+template <typename Job>
+bool job_before(const Job& a, const Job& b, WorkPolicy policy) {
+    switch (policy) {
+        case REVIEWS_FIRST:
+            if (a.kind != b.kind) return a.kind == REVIEW_JOB;
+            break;
+        case FIX_FIRST:
+            if (a.kind != b.kind) return a.kind == VERDICT_JOB;
+            break;
+        case SHORTEST_FIRST:
+            if (a.duration != b.duration) return a.duration < b.duration;
+            break;
+        case OLDEST_FIRST:
+            break;
+    }
+    return a.order < b.order;
+}